@@ -5,7 +5,7 @@
  * on a M5Stack (ESP32 MCU with integrated LCD)
  * 
  * Hague Nusseck @ electricidea
- * v1.09 03.October.2020
+ * v1.10 03.October.2020
  * https://github.com/electricidea/M5Stack-Covid19-Monitor
  * 
  * Changelog:
@@ -26,15 +26,38 @@
  * v1.09 = - aded smaller demo file to https://electricidea.github.io/
  *         - Option to load real data or short test data (36kB)
  *         - screen capute is let or right button is pressed for 2 seconds
+ * v1.10 = - button events with debouncing instead of polling
+ *         - light sleep while the display is dimmed (WiFi and backlight off)
+ *         - leaderboard of the top countries (confirmed, deaths, 7-day growth)
+ *         - zoom and pan of the graphs (hold the center button)
+ *         - background refresh of the data every 6 hours
+ *         - parser for pretty printed and minified JSON, benchmark and fuzz test
+ *           on the host (test/test_parser)
+ *         - JHU CSV files as second data source (hold the right button at start)
+ *         - country tables in the FLASH, checked against a catalog at compile time,
+ *           region and list index of every country computed by the compiler
+ *         - fixed point graph renderer for the display size
+ *         - optional HTTP server for the parsed data (SERIES_SERVER)
+ *         - days keyed by date, sums aligned by date, grid lines on mondays
+ *         - export of all series to the SD card as CSV and binary file
+ *         - parse scratch memory out of a static arena instead of the heap
+ *         - render test of all views against golden images on the host
+ *         - download progress by bytes with throughput and remaining time,
+ *           drawn on the other core
  * 
  * Distributed as-is; no warranty is given.
 **************************************************************************/
 
 #include <Arduino.h>
+#include "esp_sleep.h"
+#include "driver/gpio.h"
 
 #include <Preferences.h>
 Preferences preferences;
-String pref_fields[] = {"country_1", "country_2", "country_3", "country_4", "country_5"};
+// keys of the 5 selected countries (index 1..5, index 0 is always "All countries")
+// Version 1.09 stored the countries 1..4 as "country_2".."country_5",
+// these keys are kept, so the selection survives the update.
+const char* const pref_fields[6] = {"country_0", "country_2", "country_3", "country_4", "country_5", "country_6"};
  
 #include <M5Stack.h>
 // install the library:
@@ -53,8 +76,6 @@ WiFiClientSecure client;
 #define SCREEN_WIDTH 319
 #define SCREEN_HEIGHT 239
 
-// overall maximum to calculate the percentage of processing
-#define max_number_countries 200
 // country sekection array
 // The names must match with the country names inside the JSON file
 // 5 countries can be displayed at the same time
@@ -63,45 +84,433 @@ int country_selection[6];
 // colors for the countries
 const uint32_t country_color[6] = {LIGHTGREY, RED, GREEN, WHITE, MAGENTA, 0x51D};
 
-// A String array to hold a set of country names
+// A table in the FLASH to hold a set of country names
 // Rules:
 // The first entry is always for "All countries"
 // The second entry is always for "Europe"
 // The names must match with the country names inside the JSON file
+// (checked by the compiler against the country_catalog)
 #define n_countries 31
-String country_names[n_countries] = {"All countries", "Europe", "Australia", "Austria", "Brazil", "Canada", "China", 
+constexpr const char* country_names[n_countries] = {"All countries", "Europe", "Australia", "Austria", "Brazil", "Canada", "China", 
                       "Croatia", "Finland", "France", "Germany", "Greece", "Iran", "Italy", "Japan", "Korea, South", 
                       "Mexico", "Netherlands", "Norway", "Poland", "Portugal", "Romania", "Russia", 
                       "Spain", "Sweden", "Switzerland", "Taiwan", "Turkey", "United Kingdom", "US", "Vietnam"};
 
-// A String array to hold a the names of country that are part of Europe
+// A table in the FLASH to hold the names of country that are part of Europe
 #define n_europe_countries 44               
-String europe_names[n_europe_countries] = {"Albania", "Andorra", "Austria", "Belarus", "Belgium", "Bulgaria", 
+constexpr const char* europe_names[n_europe_countries] = {"Albania", "Andorra", "Austria", "Belarus", "Belgium", "Bulgaria", 
                       "Bosnia and Herzegovina", "Czechia", "Croatia", "Denmark", "Estonia", "Finland", "France", "Germany", 
                       "Georgia", "Greece", "Hungary", "Ireland", "Iceland", "Italy", "Kazakhstan", "Kosovo", "Latvia", 
                       "Liechtenstein", "Lithuania", "Luxembourg", "Malta", "Moldova", "Monaco", "Montenegro", 
                       "Netherlands", "North Macedonia", "Norway", "Poland", "Portugal", "Romania", "San Marino", 
-                      "Spain", "Sweden", "Switzerland", "Turkey", "Ukraine", "United Kingdom", "Vatican City"};
+                      "Spain", "Sweden", "Switzerland", "Turkey", "Ukraine", "United Kingdom", "Holy See"};
 bool part_of_europe = false;
 
-// Array field for the collected data out of the JSON file
-// collected_data[confirmed, deaths][country][data point]
-// the array is filled with data from all countries out of
-// the country_names list
-int collected_data[2][n_countries][SCREEN_WIDTH]; 
-String data_name[] = {"confirmed", "deaths"};
-// array to count the found data for each country
-int data_count[n_countries];
-// String to hold the last date found in the JSON file
-std::string last_date = "";
+// Compile time lookup of the country tables
+constexpr bool name_equal(const char* a, const char* b){
+  return (*a == *b) && (*a == 0 || name_equal(a+1, b+1));
+}
+// index of a name inside country_names (0 = not in the list)
+constexpr int country_index(const char* name, int index){
+  return index >= n_countries ? 0 :
+         (name_equal(name, country_names[index]) ? index : country_index(name, index+1));
+}
+constexpr bool europe_member(const char* name, int index){
+  return index < n_europe_countries &&
+         (name_equal(name, europe_names[index]) || europe_member(name, index+1));
+}
+
+// All country names of the JSON and CSV files (October 2020)
+// "Taiwan*" is stored without the '*'.
+// The names are sorted (checked by the compiler), so a name of the
+// data file is found by a binary search. The index inside the
+// country_names and the membership of Europe of every entry are
+// computed by the compiler.
+struct catalog_entry_t {
+  const char* name;
+  // index inside country_names (0 = not in the list)
+  uint8_t country;
+  bool europe;
+};
+#define CATALOG(name) {name, country_index(name, 2), europe_member(name, 0)}
+#define n_catalog_countries 188
+constexpr catalog_entry_t country_catalog[n_catalog_countries] = {
+  CATALOG("Afghanistan"), CATALOG("Albania"), CATALOG("Algeria"), CATALOG("Andorra"),
+  CATALOG("Angola"), CATALOG("Antigua and Barbuda"), CATALOG("Argentina"), CATALOG("Armenia"),
+  CATALOG("Australia"), CATALOG("Austria"), CATALOG("Azerbaijan"), CATALOG("Bahamas"),
+  CATALOG("Bahrain"), CATALOG("Bangladesh"), CATALOG("Barbados"), CATALOG("Belarus"),
+  CATALOG("Belgium"), CATALOG("Belize"), CATALOG("Benin"), CATALOG("Bhutan"), CATALOG("Bolivia"),
+  CATALOG("Bosnia and Herzegovina"), CATALOG("Botswana"), CATALOG("Brazil"), CATALOG("Brunei"),
+  CATALOG("Bulgaria"), CATALOG("Burkina Faso"), CATALOG("Burma"), CATALOG("Burundi"),
+  CATALOG("Cabo Verde"), CATALOG("Cambodia"), CATALOG("Cameroon"), CATALOG("Canada"),
+  CATALOG("Central African Republic"), CATALOG("Chad"), CATALOG("Chile"), CATALOG("China"),
+  CATALOG("Colombia"), CATALOG("Comoros"), CATALOG("Congo (Brazzaville)"),
+  CATALOG("Congo (Kinshasa)"), CATALOG("Costa Rica"), CATALOG("Cote d'Ivoire"), CATALOG("Croatia"),
+  CATALOG("Cuba"), CATALOG("Cyprus"), CATALOG("Czechia"), CATALOG("Denmark"),
+  CATALOG("Diamond Princess"), CATALOG("Djibouti"), CATALOG("Dominica"),
+  CATALOG("Dominican Republic"), CATALOG("Ecuador"), CATALOG("Egypt"), CATALOG("El Salvador"),
+  CATALOG("Equatorial Guinea"), CATALOG("Eritrea"), CATALOG("Estonia"), CATALOG("Eswatini"),
+  CATALOG("Ethiopia"), CATALOG("Fiji"), CATALOG("Finland"), CATALOG("France"), CATALOG("Gabon"),
+  CATALOG("Gambia"), CATALOG("Georgia"), CATALOG("Germany"), CATALOG("Ghana"), CATALOG("Greece"),
+  CATALOG("Grenada"), CATALOG("Guatemala"), CATALOG("Guinea"), CATALOG("Guinea-Bissau"),
+  CATALOG("Guyana"), CATALOG("Haiti"), CATALOG("Holy See"), CATALOG("Honduras"),
+  CATALOG("Hungary"), CATALOG("Iceland"), CATALOG("India"), CATALOG("Indonesia"), CATALOG("Iran"),
+  CATALOG("Iraq"), CATALOG("Ireland"), CATALOG("Israel"), CATALOG("Italy"), CATALOG("Jamaica"),
+  CATALOG("Japan"), CATALOG("Jordan"), CATALOG("Kazakhstan"), CATALOG("Kenya"),
+  CATALOG("Korea, South"), CATALOG("Kosovo"), CATALOG("Kuwait"), CATALOG("Kyrgyzstan"),
+  CATALOG("Laos"), CATALOG("Latvia"), CATALOG("Lebanon"), CATALOG("Lesotho"), CATALOG("Liberia"),
+  CATALOG("Libya"), CATALOG("Liechtenstein"), CATALOG("Lithuania"), CATALOG("Luxembourg"),
+  CATALOG("MS Zaandam"), CATALOG("Madagascar"), CATALOG("Malawi"), CATALOG("Malaysia"),
+  CATALOG("Maldives"), CATALOG("Mali"), CATALOG("Malta"), CATALOG("Mauritania"),
+  CATALOG("Mauritius"), CATALOG("Mexico"), CATALOG("Moldova"), CATALOG("Monaco"),
+  CATALOG("Mongolia"), CATALOG("Montenegro"), CATALOG("Morocco"), CATALOG("Mozambique"),
+  CATALOG("Namibia"), CATALOG("Nepal"), CATALOG("Netherlands"), CATALOG("New Zealand"),
+  CATALOG("Nicaragua"), CATALOG("Niger"), CATALOG("Nigeria"), CATALOG("North Macedonia"),
+  CATALOG("Norway"), CATALOG("Oman"), CATALOG("Pakistan"), CATALOG("Panama"),
+  CATALOG("Papua New Guinea"), CATALOG("Paraguay"), CATALOG("Peru"), CATALOG("Philippines"),
+  CATALOG("Poland"), CATALOG("Portugal"), CATALOG("Qatar"), CATALOG("Romania"), CATALOG("Russia"),
+  CATALOG("Rwanda"), CATALOG("Saint Kitts and Nevis"), CATALOG("Saint Lucia"),
+  CATALOG("Saint Vincent and the Grenadines"), CATALOG("San Marino"),
+  CATALOG("Sao Tome and Principe"), CATALOG("Saudi Arabia"), CATALOG("Senegal"), CATALOG("Serbia"),
+  CATALOG("Seychelles"), CATALOG("Sierra Leone"), CATALOG("Singapore"), CATALOG("Slovakia"),
+  CATALOG("Slovenia"), CATALOG("Somalia"), CATALOG("South Africa"), CATALOG("South Sudan"),
+  CATALOG("Spain"), CATALOG("Sri Lanka"), CATALOG("Sudan"), CATALOG("Suriname"), CATALOG("Sweden"),
+  CATALOG("Switzerland"), CATALOG("Syria"), CATALOG("Taiwan"), CATALOG("Tajikistan"),
+  CATALOG("Tanzania"), CATALOG("Thailand"), CATALOG("Timor-Leste"), CATALOG("Togo"),
+  CATALOG("Trinidad and Tobago"), CATALOG("Tunisia"), CATALOG("Turkey"), CATALOG("US"),
+  CATALOG("Uganda"), CATALOG("Ukraine"), CATALOG("United Arab Emirates"),
+  CATALOG("United Kingdom"), CATALOG("Uruguay"), CATALOG("Uzbekistan"), CATALOG("Venezuela"),
+  CATALOG("Vietnam"), CATALOG("West Bank and Gaza"), CATALOG("Western Sahara"), CATALOG("Yemen"),
+  CATALOG("Zambia"), CATALOG("Zimbabwe")};
+#undef CATALOG
+
+// Leaderboard of the countries with the highest numbers
+// While the JSON file is parsed, a small min-heap for each metric
+// keeps the top LEADERBOARD_SIZE out of all countries in the file.
+// The data of these countries are stored behind the configured
+// countries in the series store, so they can be selected like any
+// other country. After parsing, rank r of metric m is stored at
+// index n_countries + m*LEADERBOARD_SIZE + r.
+#define LEADERBOARD_SIZE 5
+#define n_leaderboard_metrics 3
+#define LEADERBOARD_NAME_LENGTH 24
+#define n_series (n_countries + n_leaderboard_metrics*LEADERBOARD_SIZE)
+const char* leaderboard_title[n_leaderboard_metrics] = {"Top confirmed", "Top deaths", "Top 7-day growth"};
+const char* leaderboard_tag[n_leaderboard_metrics] = {"conf.", "deaths", "7d"};
+struct leaderboard_entry_t {
+  int value;
+  // index of the data inside the series store
+  int series;
+};
+
+// Series store
+// Holds everything out of one download of the JSON file.
+// The UI only reads from the live store. A background refresh parses
+// into a second (shadow) store, which replaces the live store as soon
+// as the parse is complete and valid.
+// To keep two stores in the memory of a M5Stack without PSRAM, the days
+// of each country are stored as zigzag varint encoded differences to
+// the previous day (mostly 1-3 bytes instead of 4 per value).
+// Only the most recent SERIES_LENGTH days of each country are stored.
+// The days of a series follow each other without gaps, starting at
+// first_day. All days are epoch days (days since 1970-01-01).
+// Budget of the pool with the magnitudes of the real files
+// (bytes of a zigzag varint: < 64: 1, < 8192: 2, < 1048576: 3, else 4)
+//   country and leaderboard series: daily confirmed < 1M (3 bytes),
+//     daily deaths < 8192 (2 bytes): 44 series * 319 days * 5 = 70180
+//   "All countries" and "Europe": daily confirmed < 128M (4 bytes),
+//     daily deaths < 1M (3 bytes): 2 series * 319 days * 7 = 4466
+// The sums are stored last, STORE_SUMS_RESERVE bytes are kept free
+// for them. A series that does not fit anyway loses its oldest days.
+#define SERIES_LENGTH SCREEN_WIDTH
+#define STORE_POOL_SIZE 76800
+#define STORE_SUMS_RESERVE 4608
+struct series_t {
+  // position and size of the encoded days inside the pool
+  uint32_t offset;
+  uint16_t bytes;
+  // the deaths are stored behind the confirmed values
+  uint16_t deaths_offset;
+  // number of days
+  uint16_t count;
+  // epoch day of the first stored day
+  uint16_t first_day;
+  // value of the last day: confirmed, deaths
+  int latest[2];
+};
+struct series_store_t {
+  // index 0 = "All countries", 1 = "Europe", 2.. = country_names
+  // and behind the country_names the leaderboard
+  series_t series[n_series];
+  leaderboard_entry_t leaderboard[n_leaderboard_metrics][LEADERBOARD_SIZE];
+  int leaderboard_count[n_leaderboard_metrics];
+  char leaderboard_names[n_leaderboard_metrics*LEADERBOARD_SIZE][LEADERBOARD_NAME_LENGTH];
+  // last date found in the JSON file
+  char last_date[16];
+  // true if the JSON file was parsed completely
+  bool valid;
+  uint32_t pool_used;
+  uint8_t pool[STORE_POOL_SIZE];
+};
+// the live store the UI reads from
+series_store_t *store = NULL;
+// the store that is filled by process_data()
+series_store_t *parse_store = NULL;
+// a completely parsed store of a background refresh
+// waiting to replace the live store
+series_store_t * volatile refreshed_store = NULL;
+
+// data of the country that is currently parsed
+// the days are collected in a ring buffer and stored
+// when the country section ends
+// The position of a day inside the ring buffers is ring_pos(day).
+char current_country[LEADERBOARD_NAME_LENGTH];
+int current_data[2][SERIES_LENGTH];
+// epoch day of the first and of the current day of the country
+// (-1 = no date found yet)
+int current_first_day = -1;
+int current_day = -1;
+// the values are ignored until the next date (date out of order)
+bool current_skip = false;
+// epoch day at ring position 0
+// JSON: 0, CSV: the first stored day of the files
+int ring_base = 0;
+
+// Compile time checks of the country tables
+// A misspelled name would never be found inside the data file.
+constexpr bool in_catalog(const char* name, int index){
+  return index < n_catalog_countries &&
+         (name_equal(name, country_catalog[index].name) || in_catalog(name, index+1));
+}
+constexpr bool name_before(const char* a, const char* b){
+  return *a != *b ? (unsigned char)*a < (unsigned char)*b : (*a != 0 && name_before(a+1, b+1));
+}
+constexpr bool catalog_sorted(int index){
+  return index+1 >= n_catalog_countries ||
+         (name_before(country_catalog[index].name, country_catalog[index+1].name) && catalog_sorted(index+1));
+}
+constexpr bool name_fits(const char* name, int length){
+  return length < LEADERBOARD_NAME_LENGTH && (*name == 0 || name_fits(name+1, length+1));
+}
+constexpr bool countries_valid(int index){
+  return index >= n_countries ||
+         (in_catalog(country_names[index], 0) && name_fits(country_names[index], 0) && countries_valid(index+1));
+}
+constexpr bool europe_valid(int index){
+  return index >= n_europe_countries ||
+         (in_catalog(europe_names[index], 0) && name_fits(europe_names[index], 0) && europe_valid(index+1));
+}
+static_assert(countries_valid(2), "country_names contains an unknown or too long country name");
+static_assert(europe_valid(0), "europe_names contains an unknown or too long country name");
+static_assert(catalog_sorted(0), "country_catalog is not sorted");
+bool in_country = false;
+// "All countries" and "Europe" are summed up day by day
+// sum_data[All countries, Europe][confirmed, deaths][ring_pos(day)]
+// Every day of a country is added as soon as it is complete,
+// aligned by its date.
+int sum_data[2][2][SERIES_LENGTH];
+// first and last epoch day inside the sums (-1 = empty)
+int sum_first_day[2];
+int sum_last_day[2];
+// last values of the countries that ended before the latest day
+// sum_tail[All countries, Europe][confirmed, deaths]
+int sum_tail[2][2];
+// true if series were shortened to fit into the pool of the parse_store
+bool pool_overflow = false;
+
+// Records of the JSON file
+// The file is split at every line break and at every comma outside
+// of a string, so the pretty printed and the minified form of the
+// file give the same records. The rest of a record longer than
+// PARSE_RECORD_LENGTH is dropped.
+#define PARSE_RECORD_LENGTH 128
+struct record_t {
+  char *text;
+  int length;
+};
+// Scratch memory of a download
+// The header lines and the records are taken out of a static arena
+// instead of the heap. The arena is reset at the start of every
+// download and of every parse, so a parse does not allocate heap
+// blocks and the largest free block stays available for TLS.
+#define PARSE_ARENA_SIZE 512
+#define PARSE_HEADER_LENGTH 256
+struct parse_arena_t {
+  uint8_t memory[PARSE_ARENA_SIZE];
+  size_t used;
+  // since the start of the device
+  size_t high_water;
+  unsigned long allocations;
+  unsigned long failed;
+};
+parse_arena_t parse_arena;
+// nesting depth of {} and [] outside of strings
+int json_depth = 0;
+bool json_in_string = false;
+bool json_escape = false;
+// true as soon as the outermost object of the file is closed
+bool json_complete = false;
+// time to wait for more data from the server
+unsigned long parse_timeout_ms = 5500;
+// bytes read out of the current file and the expected length
+// (Content-Length, 0 = unknown), read by the progress task
+volatile unsigned long stream_bytes = 0;
+volatile unsigned long stream_length = 0;
+// CSV files: number of days in the header and days stored per country
+int csv_days = 0;
+int csv_count = 0;
+// epoch day of the last day in the header
+int csv_last_day = -1;
+// metrics of a series that are already stored
+// csv_filled[series][confirmed, deaths]
+bool csv_filled[n_series][2];
+int csv_countries = 0;
+// a file was incomplete or did not match the other file
+bool csv_error = false;
+// larger values and sums of a CSV file are cut to this value
+// (two of them still fit into an int)
+#define CSV_MAX_VALUE 999999999
+// timing and memory of the last process_data() call
+struct parse_stats_t {
+  unsigned long bytes;
+  unsigned long records;
+  // time spent waiting for and reading the stream
+  unsigned long read_us;
+  // time spent encoding the series into the store
+  unsigned long store_us;
+  unsigned long total_us;
+  // lowest free heap and largest free block, checked at the start
+  // of every country
+  size_t min_free_heap;
+  size_t min_largest_block;
+  // heap blocks allocated at the start and the most blocks allocated
+  // on top of them during the parse (0 = the parse does not use the heap)
+  size_t start_blocks;
+  int heap_blocks;
+};
+parse_stats_t parse_stats;
+const char* const data_name[2] = {"confirmed", "deaths"};
+
+// Background refresh of the data
+// Memory budget of a refresh on a device without PSRAM:
+//   shadow store:       sizeof(series_store_t) = about 79 kB
+//   TLS connection:     about 45 kB (REFRESH_TLS_RESERVE)
+//   refresh task stack: REFRESH_TASK_STACK
+// The live store stays allocated during the refresh, the old
+// store is freed after the swap. A refresh is only started if the
+// largest free block can hold the shadow store and the TLS
+// reserve is still free afterwards. Otherwise the refresh is
+// skipped and a notice is shown below the title of the list.
+// The free heap and the largest free block are logged at boot and
+// the minimum free heap after every refresh (Serial connection).
+#define REFRESH_INTERVAL_MS (6UL*60UL*60UL*1000UL)
+#define REFRESH_TLS_RESERVE 46000
+#define REFRESH_TASK_STACK 8192
+unsigned long last_refresh_millis = 0;
+volatile bool refresh_running = false;
+// the last refresh was skipped because of the memory budget
+volatile bool refresh_skipped = false;
+TaskHandle_t refresh_task_handle = NULL;
+
+// Progress of a download on the screen
+// The parse only counts the received bytes (stream_bytes). The bar
+// is drawn by the progress task on the other core every
+// PROGRESS_INTERVAL_MS, so the parse never waits for the display.
+// Only the grown part of the bar and the text lines are redrawn.
+#define PROGRESS_INTERVAL_MS 250
+#define PROGRESS_TASK_STACK 3072
+#define PROGRESS_BAR_X 20
+#define PROGRESS_BAR_Y 110
+#define PROGRESS_BAR_WIDTH 280
+#define PROGRESS_BAR_HEIGHT 16
+volatile bool progress_active = false;
+// number of progress_end() calls, every call is answered by the task
+// with progress_done, even if it did not draw the file at all
+volatile unsigned long progress_stops = 0;
+TaskHandle_t progress_task_handle = NULL;
+SemaphoreHandle_t progress_done = NULL;
+const char *progress_label = "";
+unsigned long progress_start_millis = 0;
+// width of the bar that is already on the screen
+int progress_drawn = 0;
+
+// HTTP server for other dashboards inside the local network
+// uncomment this line to serve the parsed data:
+//   /summary.json                 names, latest values and leaderboard
+//   /series.json  /series.bin     all series (JSON or compact binary)
+//   ?id=<index>                   only one series
+//   ?id=selected                  only the selected countries
+// The light sleep is disabled to keep the WiFi connection.
+//#define SERIES_SERVER
+#define SERVER_PORT 80
+#define SERVER_POLL_MS 5
+#define SERVER_TIMEOUT_MS 2000
+#define SERVER_TASK_STACK 6144
+// the responses are sent in chunks of this size
+#define SERVER_CHUNK_SIZE 1024
+#if defined(SERIES_SERVER)
+WiFiServer server(SERVER_PORT);
+// The server sends a response out of the store that was live at
+// its start. A store that is replaced by a refresh during the
+// response is not freed by the UI task, but handed over as
+// retired_store and freed by the server after the response,
+// or by the next swap if the server does not send it any more.
+// The mutex is only held to switch these pointers, never while
+// data is sent, so a slow client does not block the UI task.
+SemaphoreHandle_t store_mutex = NULL;
+const series_store_t *served_store = NULL;
+series_store_t *retired_store = NULL;
+struct server_stats_t {
+  unsigned long requests;
+  unsigned long bytes;
+  unsigned long busy_us;
+  unsigned long max_us;
+};
+server_stats_t server_stats;
+#endif
 // variable to switch between the graphical views
 //  0 = no graphical display
 // >0 = graphical and text display
+//  1..2  = graph, 3..4 = shifted graph, 5..10 = text, 11..13 = leaderboard
+#define n_display_states 13
 int display_state = 0;
 // varaible to switch between the menu states
+// 5 = zoom and pan sub-mode of the graph views
 int menu_state = 0;
+
+// Zoom and pan of the graph views
+// zoom_level 0 shows the full history, every level halves the visible days.
+// zoom_offset is the number of days between the latest day and the
+// right border of the graph.
+#define ZOOM_MAX_LEVEL 5
+#define ZOOM_MIN_DAYS 14
+int zoom_level = 0;
+int zoom_offset = 0;
+
+// Decoded days of the displayed series
+// They are decoded once per graph view, so every zoom and pan
+// is drawn without touching the store. A series has at most
+// SERIES_LENGTH (= SCREEN_WIDTH) days, so the days are simply
+// connected with lines at every zoom level.
+int view_data[6][SERIES_LENGTH];
+// data the view was decoded from
+int view_series[6];
+int view_data_index = -1;
+// number of lines drawn by the graph renderer (for the render test)
+unsigned long graph_draw_calls = 0;
 // Index if a Country name field should be edited
 int field_edit_index = 0;
+// Content of the country list and the menu as it is currently on the screen
+// Only the rows that differ from this state are redrawn.
+bool list_on_screen = false;
+int list_drawn_country[6];
+int list_drawn_highlighted = 0;
+int menu_drawn_index = -1;
+// color of the highlighted row in the country list
+#define LIST_HIGHLIGHT_COLOR 0x528A
+// number of pixels filled by the list and menu functions
+// printed after each button action
+unsigned long pixels_pushed = 0;
 
 // buffer for formatting numbers with thousand separator
 // see function description for further  details
@@ -111,20 +520,70 @@ char thousand_separator = '.';
 // timer to dimm the display
 unsigned long display_dimm_millis;
 bool brightness_high = true;
+// uncomment this line to keep the MCU awake while the display is dimmed
+// otherwise the idle time is spent in light sleep until a button is pressed
+//#define NO_LIGHT_SLEEP
+
+// Button handling
+// The buttons are sampled by a separate task with a fixed rate.
+// Debounced edges are put into a queue as timestamped events.
+// The menu state machine in loop() only consumes the events of this queue.
+#define BUTTON_SCAN_MS 5
+#define BUTTON_DEBOUNCE_MS 20
+#define BUTTON_LONG_PRESS_MS 2000
+#define EVENT_QUEUE_LENGTH 8
+#define n_buttons 3
+enum {BUTTON_LEFT, BUTTON_CENTER, BUTTON_RIGHT};
+// BUTTON_RELEASED is only sent if the button was released before the long press time
+// DATA_REFRESHED and REFRESH_SKIPPED are sent by the background refresh
+enum {BUTTON_PRESSED, BUTTON_LONG_PRESSED, BUTTON_RELEASED, DATA_REFRESHED, REFRESH_SKIPPED};
+const uint8_t button_pins[n_buttons] = {BUTTON_A_PIN, BUTTON_B_PIN, BUTTON_C_PIN};
+struct ui_event_t {
+  uint8_t button;
+  uint8_t type;
+  // micros() of the first (not yet debounced) edge of the button
+  unsigned long timestamp_us;
+};
+QueueHandle_t event_queue;
+// button that only restored the brightness of the display
+// its release and long press are not used for an action
+int wakeup_button = -1;
+// button-to-action latency in microseconds
+unsigned long button_latency_max_us = 0;
+unsigned long button_latency_sum_us = 0;
+unsigned long button_latency_count = 0;
 
 // Filename for Screendump to SD Card
 char Filename[24];
+// Export of all series to the SD card (center button in the start menu)
+#define EXPORT_CSV_FILE "/covid19.csv"
+#define EXPORT_BINARY_FILE "/covid19.bin"
+// the files are written in blocks of this size (a multiple of the 512 byte sectors)
+#define EXPORT_BUFFER_SIZE 8192
 
 // WiFi network configuration:
 // A simple method to configure multiple WiFi Access Configurations:
 // Add the SSID and the password to the list.
 // IMPORTANT: keep both arrays with the same length!
-String WIFI_ssid[]     = {"Home_ssid", "Work_ssid", "Mobile_ssid", "Best-Friend_ssid"};
-String WIFI_password[] = {"Home_pwd",  "Work_pwd",  "Mobile_pwd",  "Best-Friend_pwd"};
+const char* const WIFI_ssid[]     = {"Home_ssid", "Work_ssid", "Mobile_ssid", "Best-Friend_ssid"};
+const char* const WIFI_password[] = {"Home_pwd",  "Work_pwd",  "Mobile_pwd",  "Best-Friend_pwd"};
+// index of the access configuration that was connected at the start
+// the refresh connects to it again after a light sleep
+int wifi_location = -1;
 
 // uncomment this line to work with small test data (36kB)
 // instead of the large real live data
 //#define TEST_DATA
+// uncomment this line to measure the cost of the progress display
+// of version 1.09 and of the progress task with synthetic data
+// before the real data is loaded (results over the Serial connection)
+// The benchmark and the fuzz test of the parser and the pixels of
+// both progress displays run on the host:
+//   pio test -e native
+//#define PROGRESS_BENCHMARK
+// size of the synthetic data (1x = size of the file in October 2020)
+#define SYNTHETIC_COUNTRIES 188
+#define SYNTHETIC_DAYS 256
 // the actual data are provided on this github page:
 // https://github.com/pomber/covid19
 // JSON time-series of coronavirus cases (confirmed, deaths and recovered) per country
@@ -134,9 +593,30 @@ String WIFI_password[] = {"Home_pwd",  "Work_pwd",  "Mobile_pwd",  "Best-Friend_
   // small partial example JSON file from January 2020:
   // https://electricidea.github.io/M5Stack-Covid19-Monitor/20200128_timeseries.json
   const char*  data_server_name= "electricidea.github.io";  // Server URL
+  const char*  data_path= "/M5Stack-Covid19-Monitor/20200128_timeseries.json";
 #else
   const char*  data_server_name= "pomber.github.io";  // Server URL
+  const char*  data_path= "/covid19/timeseries.json";
 #endif
+// The same data as CSV time-series of JHU (one file per metric):
+// https://github.com/CSSEGISandData/COVID-19
+// raw.githubusercontent.com uses the same root certificate as github.io
+const char*  csv_server_name= "raw.githubusercontent.com";
+const char*  csv_paths[2]= {
+  "/CSSEGISandData/COVID-19/master/csse_covid_19_data/csse_covid_19_time_series/time_series_covid19_confirmed_global.csv",
+  "/CSSEGISandData/COVID-19/master/csse_covid_19_data/csse_covid_19_time_series/time_series_covid19_deaths_global.csv"};
+
+// Data sources
+// Every source downloads its files and parses them into a series store.
+// The source is stored in the FLASH. Hold the right button during
+// the welcome screen to switch to the next source.
+struct data_source_t {
+  const char *name;
+  // returns false if the connection to the server failed
+  bool (*load)(series_store_t *target, bool show_progress);
+};
+#define n_data_sources 2
+int data_source = 0;
 
 // Certificate for Website:
 // https://github.io
@@ -172,22 +652,228 @@ const char* root_ca= \
 void scan_WIFI();
 boolean connect_Wifi(const char * ssid, const char * password);
 const char *formatNumber(int value, char *buffer, int len);
-void ReplaceStringInPlace(std::string& subject, const std::string& search,
-                          const std::string& replace);
 void Clear_Screen();
-int process_data();
+int process_data(Stream &stream, series_store_t *target);
+bool read_record(Stream &stream, record_t &record);
+int stream_read(Stream &stream);
+int record_number(const record_t &record);
+void record_text(const record_t &record, char *buffer, int len);
+void *arena_alloc(size_t size);
+void arena_reset();
+void parse_stats_begin();
+void parse_stats_heap();
+void log_parse_stats(const char *label);
+#if defined(PROGRESS_BENCHMARK)
+void synthetic_name(int country, char *buffer, int len);
+void synthetic_date(int day, int &year, int &month, int &day_of_month);
+int synthetic_value(int country, int day);
+#endif
+#if defined(PROGRESS_BENCHMARK)
+void legacy_progress(int countries_found);
+void progress_benchmark();
+#endif
+void progress_begin(const char *label);
+void progress_end();
+void progress_task(void * parameter);
+void draw_progress(bool first);
+bool request_data(const char *server, const char *path);
+bool load_json(series_store_t *target, bool show_progress);
+bool load_csv(series_store_t *target, bool show_progress);
+void csv_begin(series_store_t *target);
+int process_csv(Stream &stream, int metric, bool rank);
+void csv_end_country(int metric, bool rank);
+bool csv_missing(int metric);
+void csv_finish();
+int csv_day(const char *text);
+int epoch_day(int year, int month, int day);
+void format_date(int day, char *buffer, int len);
+void split_date(int day, int &year, int &month, int &day_of_month);
+int record_date(const record_t &record);
+const catalog_entry_t* find_catalog(const char* name);
+int find_country(const char* name);
+void log_heap(const char *label);
+bool is_europe(const char* name);
+const char* parse_series_name(int index);
+void refresh_task(void * parameter);
+void refresh_data();
+void swap_store();
+#if defined(SERIES_SERVER)
+void server_task(void * parameter);
+void serve_request(WiFiClient &http_client);
+bool read_http_line(WiFiClient &http_client, char *line, int len);
+void print_json_string(Print &out, const char *text);
+void send_summary(Print &out, const series_store_t *source);
+void send_series_json(Print &out, const series_store_t *source, const int *ids, int n_ids);
+#endif
+int select_series(const series_store_t *source, const char *query, int *ids);
+void send_series_binary(Print &out, const series_store_t *source, const int *ids, int n_ids);
+void export_data();
+bool export_file(const char *path, bool binary, uint8_t *buffer, unsigned long &bytes, unsigned long &duration_us);
+void export_csv(Print &out);
+void print_int(Print &out, int value);
+void store_clear(series_store_t *target);
+bool store_series(series_store_t *target, int index, const int data[2][SERIES_LENGTH], int first, int count, int first_day);
+bool store_current(series_store_t *target, int index);
+void store_sums(series_store_t *target);
+void store_compact(series_store_t *target);
+void load_series(const series_store_t *source, int index, int data_index, int *values);
+void start_country(const char* line);
+int ring_pos(int day);
+void set_day(int day);
+void finish_day(int day);
+void sum_add(int n, int data_index, int day, int value);
+void sum_end(int n, int data_index, int day, int value);
+int sum_saturate(int64_t value);
+void sums_clear();
+void add_value(int data_index, int value);
+void end_country(int index);
+void leaderboard_end_country();
+int leaderboard_insert(int metric, int value);
+void leaderboard_sift_down(leaderboard_entry_t *heap, int n, int i);
+void leaderboard_sort();
+void swap_series(int a, int b);
+const char* series_name(int index);
+const char* series_name_in(const series_store_t *source, int index);
+int latest_value(int data_index, int index);
+void display_data(int state);
+void load_view(int data_index);
+void view_range(int n, int first, int last, int &y_min, int &y_max);
+void draw_series_window(int n, int first, int window, int max_y, uint32_t color);
+void zoom_range(int &first_day, int &last_day);
+int zoom_history();
+int zoom_days();
+void zoom_pan(int days);
 void display_data_graph(int data_select);
 void display_data_graph_shifted(int data_select);
 void display_data_text(int data_select);
+void display_data_leaderboard(int data_select);
 void print_list(int highlighted);
+void print_list_row(int row, int highlighted, bool cleared);
+void print_refresh_notice();
+void invalidate_list();
 void print_menu(int menu_index);
 void set_display_brightness(int brightness);
+void button_task(void * parameter);
+TickType_t idle_ticks();
+void idle_sleep();
 bool M5Screen2File(fs::FS &fs, const char * path);
 
+// the available data sources
+data_source_t data_sources[n_data_sources] = {
+  {"JSON (pomber)", load_json},
+  {"CSV (JHU)", load_csv}
+};
+
+//==============================================================
+// Graph, grid and legend renderer for a display with the
+// highest coordinates MAX_X / MAX_Y
+// (M5Stack: 319/239, M5StickC in landscape: 159/79)
+// The positions are calculated in fixed point instead of float:
+//   x = day * x_step >> 20     y = value * y_step >> 32
+// and y is corrected to round(value * (MAX_Y-1) / max_value)
+// with the halves rounded up, so both are exact.
+// Everything that depends on the display is a compile time
+// constant, the two steps are calculated once per graph.
+template<int MAX_X, int MAX_Y>
+struct graph_renderer_t {
+  enum { width = MAX_X, height = MAX_Y, compact = (MAX_X < 200) };
+  // pixel per day with 20 fraction bits (rounded up, so that
+  // x() is exact for up to 1024 days)
+  uint32_t x_step;
+  // pixel per value with 32 fraction bits
+  int64_t y_step;
+  int y_max;
+
+  // scale window days to the full width
+  // and the values 0..max_value to the full height
+  void scale(int window, int max_value){
+    if(window < 1)
+      window = 1;
+    if(max_value < 1)
+      max_value = 1;
+    x_step = (((uint32_t)MAX_X << 20) + window - 1) / window;
+    y_step = ((int64_t)(MAX_Y-1) << 32) / max_value;
+    y_max = max_value;
+  }
+  int x(int day) const {
+    return ((uint32_t)day * x_step) >> 20;
+  }
+  int y(int value) const {
+    int64_t pixel = ((int64_t)value * y_step + 0x80000000LL) >> 32;
+    // y_step is rounded down, so the estimate is off by at most one
+    int64_t twice = (int64_t)value * (2*(MAX_Y-1)) + y_max;
+    if((pixel+1) * 2*y_max <= twice)
+      pixel++;
+    else if(pixel * 2*y_max > twice)
+      pixel--;
+    return (MAX_Y-1) - (int)pixel;
+  }
+
+  // weekly grid lines on the mondays of the calendar
+  // first_day: epoch day at x = 0
+  void grid_weeks(int first_day, int window){
+    // 1970-01-01 was a thursday, so the mondays are the days with (day+3) % 7 == 0
+    for(int day = first_day + (7 - (first_day+3) % 7) % 7; day < first_day + window; day += 7){
+      M5.Lcd.drawFastVLine(x(day - first_day), 0, MAX_Y, 0x528A);
+      graph_draw_calls++;
+    }
+  }
+  // weekly grid lines, aligned with the first day
+  void grid_from_start(int days){
+    for(int day = 0; day < days; day += 7){
+      M5.Lcd.drawFastVLine(x(day), 0, MAX_Y, 0x528A);
+      graph_draw_calls++;
+    }
+  }
+
+  // connect the days begin-1..end-1 with lines,
+  // the day first is drawn at x = 0 (begin > first, x() is
+  // only defined for days >= 0)
+  void series_lines(const int *data, int first, int begin, int end, uint32_t color){
+    for(int i = begin; i < end; i++)
+      M5.Lcd.drawLine(x(i-1-first), y(data[i-1]), x(i-first), y(data[i]), color);
+    if(end > begin)
+      graph_draw_calls += end - begin;
+  }
+
+  // legend in the top left corner
+  // a small display gets the small font and one line per country
+  void legend_begin(){
+    if(compact)
+      M5.Lcd.setTextFont(1);
+    else
+      M5.Lcd.setFreeFont(FF1);
+    M5.Lcd.setCursor(0, 0);
+    M5.Lcd.setTextColor(WHITE);
+  }
+  void legend_headline(const char *text, const char *detail){
+    if(compact)
+      M5.Lcd.printf("%s\n", text);
+    else
+      M5.Lcd.printf("\n%s (%s)\n\n", text, detail);
+  }
+  // value can be NULL
+  void legend_entry(uint32_t color, const char *name, const char *value){
+    M5.Lcd.setTextColor(color);
+    if(value == NULL)
+      M5.Lcd.printf("%s\n", name);
+    else if(compact)
+      M5.Lcd.printf("%.10s %s\n", name, value);
+    else
+      M5.Lcd.printf("%s:\n%s\n", name, value);
+  }
+  void legend_end(){
+    M5.Lcd.setTextColor(WHITE);
+  }
+};
+// the renderer of this display
+typedef graph_renderer_t<SCREEN_WIDTH, SCREEN_HEIGHT> graph_renderer;
+
 
 void setup() {
     // initialize the M5Stack object
     M5.begin();
+    log_heap("boot");
     // configure the Lcd display
     set_display_brightness(100); //Brightness (0: Off - 255: Full)
     M5.Lcd.setTextColor(WHITE);
@@ -198,10 +884,22 @@ void setup() {
     M5.Lcd.setFreeFont(FF2);
     M5.Lcd.drawString("Covid-19 Monitor", (int)(M5.Lcd.width()/2), (int)(M5.Lcd.height()/2), 1);
     M5.Lcd.setFreeFont(FF1);
-    M5.Lcd.drawString("Version 1.09 | 03.10.2020", (int)(M5.Lcd.width()/2), M5.Lcd.height()-20, 1);
+    M5.Lcd.drawString("Version 1.10 | 03.10.2020", (int)(M5.Lcd.width()/2), M5.Lcd.height()-20, 1);
+    // get the data source
+    preferences.begin("country-config", false);
+    data_source = preferences.getUInt("data_source", 0);
+    if(data_source >= n_data_sources)
+      data_source = 0;
+    M5.Lcd.drawString(data_sources[data_source].name, (int)(M5.Lcd.width()/2), (int)(M5.Lcd.height()/2)+40, 1);
     // print Welcome screen over Serial connection
     // wait 5 seconds before start file action
     delay(5000);
+    // switch to the next data source if the right button is held
+    if(digitalRead(BUTTON_C_PIN) == LOW){
+      data_source = (data_source+1) % n_data_sources;
+      preferences.putUInt("data_source", data_source);
+    }
+    preferences.end();
     // configure Top-Left oriented String output
     M5.Lcd.setTextDatum(TL_DATUM);
     // scan and display available WIFI networks
@@ -216,7 +914,8 @@ void setup() {
       while(WiFi.status() != WL_CONNECTED){
         delay(1000);
         Clear_Screen();
-        connect_Wifi(WIFI_ssid[WIFI_location].c_str(), WIFI_password[WIFI_location].c_str());
+        if(connect_Wifi(WIFI_ssid[WIFI_location], WIFI_password[WIFI_location]))
+          wifi_location = WIFI_location;
         WIFI_location++;
         if(WIFI_location >= (sizeof(WIFI_ssid)/sizeof(WIFI_ssid[0])))
           WIFI_location = 0;
@@ -224,57 +923,61 @@ void setup() {
       M5.Lcd.println("");
       M5.Lcd.println("[OK] Connected to WiFi");
     }
+    log_heap("WiFi");
     delay(2000);
-    // init the array for "All Countries" and "Europe"#
-    for(int i=0; i<SCREEN_WIDTH; i++){
-      collected_data[0][0][i] = 0; 
-      collected_data[1][0][i] = 0; 
-      collected_data[0][1][i] = 0; 
-      collected_data[1][1][i] = 0; 
-    }
     // Download and parse the JSON data file
     Clear_Screen();
+    // the first download is parsed directly into the live store
+    store = (series_store_t*)malloc(sizeof(series_store_t));
+    if(store == NULL){
+      M5.Lcd.println("[ERR] not enough memory!");
+      while(true)
+        delay(100);
+    }
+#if defined(PROGRESS_BENCHMARK)
+    progress_benchmark();
+    delay(5000);
+    Clear_Screen();
+#endif
     // set the certificate for the https connection to github.io
     M5.Lcd.println("[OK] set certificate");
     client.setCACert(root_ca);
     // connect to the server
+    M5.Lcd.printf("Data source: %s\n", data_sources[data_source].name);
     M5.Lcd.println("Starting connection...");
-    if (!client.connect(data_server_name, 443)){
+    if (!data_sources[data_source].load(store, true)){
       M5.Lcd.println("[ERR] Connection failed!");
       while(true)
         delay(100);
     } else {
-      M5.Lcd.println("[OK] Connected to server");
-      delay(200);
-      // Make a HTTP request:
-      #if defined(TEST_DATA)
-        client.println("GET https://electricidea.github.io/M5Stack-Covid19-Monitor/20200128_timeseries.json HTTP/1.0");
-        client.println("Host: electricidea.github.io");
-      #else
-        client.println("GET https://pomber.github.io/covid19/timeseries.json HTTP/1.0");
-        client.println("Host: pomber.github.io");
-      #endif
-      client.println("Connection: close");
-      client.println();
-      // get the JSON data from the github server
-      // and calculate the values
-      process_data();
-      // close the connection to the server
-      client.stop();
       M5.Lcd.println("[DONE]");
       delay(2000);
     }
+    log_parse_stats("data");
+    log_heap("data");
+    last_refresh_millis = millis();
     // get the list of countries to be shown
     // the values are stored in the FLASH
     preferences.begin("country-config", false);
     country_selection[0] = 0; // Always "All countries"
-    char Key_String[12];
     for(int n=1; n<6; n++){
-      pref_fields[n].toCharArray(Key_String, sizeof(Key_String));
-      country_selection[n] = preferences.getUInt(Key_String,n);
+      country_selection[n] = preferences.getUInt(pref_fields[n],n);
+      if(country_selection[n] >= n_series)
+        country_selection[n] = n;
     }
     // close the preferences
     preferences.end();
+    // start the button sampling task
+    event_queue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(ui_event_t));
+    xTaskCreatePinnedToCore(button_task, "buttons", 2048, NULL, 2, NULL, 1);
+    // start the background refresh on the other core
+    xTaskCreatePinnedToCore(refresh_task, "refresh", REFRESH_TASK_STACK, NULL, 1, &refresh_task_handle, 0);
+#if defined(SERIES_SERVER)
+    // start the HTTP server on the other core
+    store_mutex = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(server_task, "server", SERVER_TASK_STACK, NULL, 1, NULL, 0);
+    Serial.printf("[OK] server: http://%s:%i/summary.json\n", WiFi.localIP().toString().c_str(), SERVER_PORT);
+#endif
     // ready to edit the list or visualize the data
     // print the start Menu
     field_edit_index = 0;
@@ -288,16 +991,48 @@ void setup() {
 
 
 void loop() {
-  M5.update();  
-  // dimm the display if no button was pressed
-  if(brightness_high && millis() > display_dimm_millis){
-    M5.Lcd.setBrightness(20); //Brightness (0: Off - 255: Full)
-    brightness_high = false;
+  ui_event_t event;
+  // wait for the next button event
+  // the CPU is idle until a button is pressed or the display must be dimmed
+  if(xQueueReceive(event_queue, &event, idle_ticks()) != pdTRUE){
+    // dimm the display if no button was pressed
+    if(brightness_high && millis() > display_dimm_millis){
+      M5.Lcd.setBrightness(20); //Brightness (0: Off - 255: Full)
+      brightness_high = false;
+    }
+    if(!brightness_high)
+      idle_sleep();
+    return;
+  }
+
+  // the background refresh has a new store
+  // swap it with the live store and show the new data
+  if(event.type == DATA_REFRESHED){
+    swap_store();
+    view_data_index = -1;
+    zoom_pan(0);
+    if(menu_state >= 4){
+      display_data(display_state);
+    } else if(list_on_screen){
+      // the names of the leaderboard entries may have changed
+      for(int n=1; n<6; n++)
+        list_drawn_country[n] = -1;
+      print_list(list_drawn_highlighted);
+      print_refresh_notice();
+    }
+    return;
+  }
+
+  // the background refresh was skipped (not enough memory)
+  if(event.type == REFRESH_SKIPPED){
+    if(list_on_screen)
+      print_refresh_notice();
+    return;
   }
 
   // if the left or right Button was pressed for 2 seconds,
   // a screen capture is saved to SD card
-  if ((M5.BtnA.pressedFor(2000) || M5.BtnC.pressedFor(2000)) && Filename[0] == '/'){
+  if (event.type == BUTTON_LONG_PRESSED && event.button != BUTTON_CENTER && Filename[0] == '/'){
     if(M5Screen2File(SD, Filename)){
       M5.Lcd.setTextColor(WHITE);
       M5.Lcd.setTextSize(1);
@@ -321,9 +1056,13 @@ void loop() {
     // next screendump only if a Filename is set
     Filename[0] = ' ';
   }
+
+  // a press while the display is dimmed only restores the brightness
+  if(event.type == BUTTON_PRESSED)
+    wakeup_button = brightness_high ? -1 : event.button;
   
   // left Button
-  if (M5.BtnA.wasPressed()){
+  if (event.type == BUTTON_PRESSED && event.button == BUTTON_LEFT){
     if(!brightness_high){
       set_display_brightness(100);
     } else {
@@ -345,7 +1084,7 @@ void loop() {
         }
         case 3: {   //  < (Country name selection)
           if(--country_selection[field_edit_index] < 0)
-            country_selection[field_edit_index] = n_countries-1;
+            country_selection[field_edit_index] = n_series-1;
           print_list(field_edit_index);
           print_menu(menu_state);
           break;       
@@ -353,15 +1092,13 @@ void loop() {
         case 4: {   // Prev Page
           display_state--;
           if(display_state < 1)
-            display_state = 10;  
-          if(display_state < 3)
-            display_data_graph(display_state);
-          else{
-            if(display_state < 5)
-              display_data_graph_shifted(display_state);
-            else
-              display_data_text(display_state);
-          }
+            display_state = n_display_states;  
+          display_data(display_state);
+          break;       
+        }
+        case 5: {   // << (pan to older data)
+          zoom_pan(zoom_days()/4);
+          display_data_graph(display_state);
           break;       
         }
       } 
@@ -369,14 +1106,14 @@ void loop() {
   }
 
   // center Button
-  if (M5.BtnB.wasPressed()){
+  if (event.type == BUTTON_PRESSED && event.button == BUTTON_CENTER){
     if(!brightness_high){
       set_display_brightness(100);
     } else {
       display_dimm_millis = millis() + 20000;
       switch (menu_state) {
-        case 1: {   //  
-        
+        case 1: {   //  EXPORT
+          export_data();
           break;       
         }
         case 2: {   //  EDIT
@@ -387,30 +1124,65 @@ void loop() {
         }
         case 3: {   //  OK
           menu_state = 2;
-          char Key_String[12];
-          pref_fields[field_edit_index].toCharArray(Key_String, sizeof(Key_String));
           // save selection
           preferences.begin("country-config", false);
-          preferences.putUInt(Key_String, country_selection[field_edit_index]);
+          preferences.putUInt(pref_fields[field_edit_index], country_selection[field_edit_index]);
           preferences.end();
           print_list(field_edit_index);
           print_menu(menu_state);
           break;       
         }
-        case 4: {   // Back 
-          // print the start Menu
-          display_state = 0;
-          menu_state = 1;
-          print_list(0);
-          print_menu(menu_state);
+        case 4: {   // Back (on release)
           break;       
         }
       }
     }
   }
 
+  // center Button released before the long press time
+  if (event.type == BUTTON_RELEASED && event.button == BUTTON_CENTER && event.button != wakeup_button){
+    display_dimm_millis = millis() + 20000;
+    switch (menu_state) {
+      case 4: {   // Back 
+        // print the start Menu
+        display_state = 0;
+        menu_state = 1;
+        print_list(0);
+        print_menu(menu_state);
+        break;       
+      }
+      case 5: {   // ZOOM
+        // zoom in until the minimum number of days is reached
+        // then start again with the full history
+        zoom_level++;
+        if(zoom_level > ZOOM_MAX_LEVEL || zoom_days() < ZOOM_MIN_DAYS){
+          zoom_level = 0;
+          zoom_offset = 0;
+        }
+        zoom_pan(0);
+        display_data_graph(display_state);
+        break;       
+      }
+    }
+  }
+
+  // center Button hold down for 2 seconds
+  // switch the zoom and pan sub-mode of the graph views on or off
+  if (event.type == BUTTON_LONG_PRESSED && event.button == BUTTON_CENTER && event.button != wakeup_button){
+    display_dimm_millis = millis() + 20000;
+    if(menu_state == 4 && display_state < 3){
+      menu_state = 5;
+      display_data_graph(display_state);
+    } else if(menu_state == 5){
+      menu_state = 4;
+      zoom_level = 0;
+      zoom_offset = 0;
+      display_data_graph(display_state);
+    }
+  }
+
   // right Button
-  if (M5.BtnC.wasPressed()){
+  if (event.type == BUTTON_PRESSED && event.button == BUTTON_RIGHT){
     if(!brightness_high){
       set_display_brightness(100);
     } else {
@@ -432,7 +1204,7 @@ void loop() {
           break;       
         }
         case 3: {   //  > (Country name selection)
-          if(++country_selection[field_edit_index] == n_countries)
+          if(++country_selection[field_edit_index] == n_series)
             country_selection[field_edit_index] = 0;
           print_list(field_edit_index);
           print_menu(menu_state);
@@ -440,53 +1212,152 @@ void loop() {
         }
         case 4: {   // Next Page 
           display_state++;
-          if(display_state > 10)
+          if(display_state > n_display_states)
             display_state = 1;  
-          if(display_state < 3)
-            display_data_graph(display_state);
-          else{
-            if(display_state < 5)
-              display_data_graph_shifted(display_state);
-            else
-              display_data_text(display_state);
-          }
+          display_data(display_state);
+          break;       
+        }
+        case 5: {   // >> (pan to newer data)
+          zoom_pan(-zoom_days()/4);
+          display_data_graph(display_state);
           break;       
         }
       }
     }
   }
+
+  // measure the time from the button edge until the action is done
+  unsigned long latency_us = micros() - event.timestamp_us;
+  if(latency_us > button_latency_max_us)
+    button_latency_max_us = latency_us;
+  button_latency_sum_us += latency_us;
+  button_latency_count++;
+  Serial.printf("[BTN] %i latency: %lu us (avg: %lu us, max: %lu us) pixels: %lu\n", event.button, latency_us,
+                button_latency_sum_us/button_latency_count, button_latency_max_us, pixels_pushed);
+  pixels_pushed = 0;
 }
 
 
 //==============================================================
 // Print the list of countries that are selected to show.
+// If the list is already on the screen, only the rows that
+// changed (name or highlight) are redrawn.
 void print_list(int highlighted){
-  Clear_Screen();
+  bool cleared = false;
+  if(!list_on_screen){
+    Clear_Screen();
+    pixels_pushed += M5.Lcd.width() * M5.Lcd.height();
+    // center aligned String output
+    M5.Lcd.setTextDatum(CC_DATUM);
+    M5.Lcd.setFreeFont(FF2);
+    M5.Lcd.drawString("Covid-19 Monitor", (int)(M5.Lcd.width()/2), (int)(M5.Lcd.height()/6), 1);
+    if(refresh_skipped)
+      print_refresh_notice();
+    for(int n=1; n<6; n++)
+      list_drawn_country[n] = -1;
+    list_drawn_highlighted = 0;
+    list_on_screen = true;
+    cleared = true;
+  }
+  // find the rows that must be redrawn
+  // The highlight bar reaches 2 pixel into the next row.
+  // So the next row is redrawn as well if the highlight changes.
+  bool row_dirty[7] = {false, false, false, false, false, false, false};
+  for(int n=1; n<6; n++){
+    if(list_drawn_country[n] != country_selection[n])
+      row_dirty[n] = true;
+  }
+  if(highlighted != list_drawn_highlighted){
+    row_dirty[list_drawn_highlighted] = true;
+    row_dirty[list_drawn_highlighted+1] = true;
+    row_dirty[highlighted] = true;
+    row_dirty[highlighted+1] = true;
+  }
   // center aligned String output
   M5.Lcd.setTextDatum(CC_DATUM);
-  M5.Lcd.setFreeFont(FF2);
-  M5.Lcd.drawString("Covid-19 Monitor", (int)(M5.Lcd.width()/2), (int)(M5.Lcd.height()/6), 1);
   M5.Lcd.setFreeFont(FF1);
-  // Country names
-  int y_pos = (int)(M5.Lcd.height()/6)+50;
   for(int n=1; n<6; n++){
-    M5.Lcd.setTextColor(country_color[n]);
-    // highlight a line if selected
-    if(highlighted == n){
-      M5.Lcd.fillRect(0, y_pos-10, M5.Lcd.width(), 22, 0x528A);
-    }
-    M5.Lcd.drawString(country_names[country_selection[n]].c_str(), (int)(M5.Lcd.width()/2), y_pos, 1);
-    y_pos = y_pos + 20;
+    if(row_dirty[n])
+      print_list_row(n, highlighted, cleared);
   }
+  list_drawn_highlighted = highlighted;
   // left aligned String output
   M5.Lcd.setTextDatum(TL_DATUM);
   M5.Lcd.setTextColor(WHITE);
 }
 
+//==============================================================
+// Print one row of the country list
+// Each row owns 20 pixel of the screen.
+// The 22 pixel highlight bar of the row above is restored before
+// the name is printed, so the result is the same as a full redraw.
+// cleared = true if the screen is already black
+void print_list_row(int row, int highlighted, bool cleared){
+  int y_pos = (int)(M5.Lcd.height()/6)+50 + (row-1)*20;
+  if(highlighted == row){
+    M5.Lcd.fillRect(0, y_pos-10, M5.Lcd.width(), 20, LIST_HIGHLIGHT_COLOR);
+    pixels_pushed += M5.Lcd.width() * 20;
+  } else if(!cleared){
+    M5.Lcd.fillRect(0, y_pos-10, M5.Lcd.width(), 20, BLACK);
+    pixels_pushed += M5.Lcd.width() * 20;
+  }
+  if(highlighted == row-1 && row > 1){
+    M5.Lcd.fillRect(0, y_pos-10, M5.Lcd.width(), 2, LIST_HIGHLIGHT_COLOR);
+    pixels_pushed += M5.Lcd.width() * 2;
+  }
+  // the last row has no next row to take care of the 2 pixel below
+  if(row == 5 && (highlighted == row || !cleared)){
+    M5.Lcd.fillRect(0, y_pos+10, M5.Lcd.width(), 2, highlighted == row ? LIST_HIGHLIGHT_COLOR : BLACK);
+    pixels_pushed += M5.Lcd.width() * 2;
+  }
+  M5.Lcd.setTextColor(country_color[row]);
+  int index = country_selection[row];
+  if(index < n_countries){
+    M5.Lcd.drawString(series_name(index), (int)(M5.Lcd.width()/2), y_pos, 1);
+  } else {
+    // mark the entries of the leaderboard with their rank
+    char label[48];
+    snprintf(label, sizeof(label), "%s (%s #%i)", series_name(index),
+             leaderboard_tag[(index-n_countries)/LEADERBOARD_SIZE], (index-n_countries)%LEADERBOARD_SIZE+1);
+    M5.Lcd.drawString(label, (int)(M5.Lcd.width()/2), y_pos, 1);
+  }
+  list_drawn_country[row] = country_selection[row];
+}
+
+//==============================================================
+// Show or remove the notice below the title of the list
+// that the background refresh is skipped (not enough memory)
+void print_refresh_notice(){
+  int y_pos = (int)(M5.Lcd.height()/6)+24;
+  M5.Lcd.fillRect(0, y_pos-8, M5.Lcd.width(), 16, BLACK);
+  pixels_pushed += M5.Lcd.width() * 16;
+  if(refresh_skipped){
+    M5.Lcd.setTextDatum(CC_DATUM);
+    M5.Lcd.setFreeFont(FF1);
+    M5.Lcd.setTextColor(RED);
+    M5.Lcd.drawString("Refresh skipped: low memory", (int)(M5.Lcd.width()/2), y_pos, 1);
+    M5.Lcd.setTextDatum(TL_DATUM);
+    M5.Lcd.setTextColor(WHITE);
+  }
+}
+
+//==============================================================
+// The country list and the menu are no longer on the screen
+// The next print_list() and print_menu() draw everything again.
+void invalidate_list(){
+  list_on_screen = false;
+  menu_drawn_index = -1;
+}
+
 //==============================================================
 // Print a small menu at the bottom of the display above the buttons
 void print_menu(int menu_index){
+    // nothing to do if this menu is already on the screen
+    if(menu_index == menu_drawn_index)
+      return;
+    menu_drawn_index = menu_index;
     M5.Lcd.fillRect(0, M5.Lcd.height()-25, M5.Lcd.width(), 25, 0x7BEF);
+    pixels_pushed += M5.Lcd.width() * 25;
     M5.Lcd.setCursor(0, 230);    
     M5.Lcd.setFreeFont(FF1);
     M5.Lcd.setTextColor(WHITE);
@@ -496,7 +1367,7 @@ void print_menu(int menu_index){
         break;       
       }
       case 1: { // start menu
-        M5.Lcd.print("    EDIT             SHOW");
+        M5.Lcd.print("    EDIT   EXPORT    SHOW");
         break;
       }
       case 2: { // Edit submenu for line selection
@@ -511,6 +1382,10 @@ void print_menu(int menu_index){
         M5.Lcd.print("      <      BACK      > ");
         break;
       }
+      case 5: { // zoom and pan of a graph
+        M5.Lcd.print("     <<      ZOOM     >> ");
+        break;
+      }
       default: { // should never been called
         M5.Lcd.print("      -       -        - ");
         break;
@@ -525,8 +1400,107 @@ void set_display_brightness(int brightness){
   M5.Lcd.setBrightness(brightness); //Brightness (0: Off - 255: Full)
   display_dimm_millis = millis() + 20000;
   brightness_high = true;
-  // Delay as helping function to detect a single key press of the butons
-  delay(500);
+}
+
+//==============================================================
+// Task to sample the buttons with a fixed rate
+// A new button state is accepted if it is stable for BUTTON_DEBOUNCE_MS.
+// Every accepted press and every long press is put into the event_queue.
+void button_task(void * parameter){
+  bool stable_pressed[n_buttons];
+  bool raw_pressed[n_buttons];
+  bool long_press_sent[n_buttons];
+  unsigned long edge_us[n_buttons];
+  unsigned long pressed_millis[n_buttons];
+  for(int n=0; n<n_buttons; n++){
+    pinMode(button_pins[n], INPUT_PULLUP);
+    stable_pressed[n] = false;
+    raw_pressed[n] = false;
+    long_press_sent[n] = true;
+    edge_us[n] = micros();
+    pressed_millis[n] = millis();
+  }
+  TickType_t last_wake = xTaskGetTickCount();
+  while(true){
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(BUTTON_SCAN_MS));
+    for(int n=0; n<n_buttons; n++){
+      // the buttons are low active
+      bool pressed = digitalRead(button_pins[n]) == LOW;
+      if(pressed != raw_pressed[n]){
+        // remember the first edge to measure the latency
+        raw_pressed[n] = pressed;
+        edge_us[n] = micros();
+        continue;
+      }
+      if(pressed != stable_pressed[n] && 
+         micros() - edge_us[n] >= BUTTON_DEBOUNCE_MS*1000UL){
+        stable_pressed[n] = pressed;
+        if(pressed){
+          ui_event_t event = {(uint8_t)n, BUTTON_PRESSED, edge_us[n]};
+          // if the queue is full, the event is dropped
+          xQueueSend(event_queue, &event, 0);
+          pressed_millis[n] = millis();
+          long_press_sent[n] = false;
+        } else if(!long_press_sent[n]){
+          ui_event_t event = {(uint8_t)n, BUTTON_RELEASED, edge_us[n]};
+          xQueueSend(event_queue, &event, 0);
+        }
+      }
+      if(stable_pressed[n] && !long_press_sent[n] &&
+         millis() - pressed_millis[n] >= BUTTON_LONG_PRESS_MS){
+        ui_event_t event = {(uint8_t)n, BUTTON_LONG_PRESSED, micros()};
+        xQueueSend(event_queue, &event, 0);
+        long_press_sent[n] = true;
+      }
+    }
+  }
+}
+
+//==============================================================
+// Number of ticks loop() can wait for the next button event
+// before the display must be dimmed
+TickType_t idle_ticks(){
+  // try to enter the light sleep again every second
+  if(!brightness_high)
+    return pdMS_TO_TICKS(1000);
+  unsigned long now = millis();
+  if(now >= display_dimm_millis)
+    return 0;
+  return pdMS_TO_TICKS(display_dimm_millis - now);
+}
+
+//==============================================================
+// Wait in light sleep until a button is pressed
+// or the next background refresh is due
+// The WiFi is stopped before the sleep and started again by
+// the refresh. The LEDC stops with the APB clock, so the
+// backlight is switched off for the sleep and set back to the
+// dimmed level after it.
+void idle_sleep(){
+#if !defined(NO_LIGHT_SLEEP) && !defined(SERIES_SERVER)
+  // do not sleep while a button is still pressed or events are pending
+  if(uxQueueMessagesWaiting(event_queue) > 0)
+    return;
+  // do not sleep during a refresh or if a refresh is due
+  unsigned long since_refresh = millis() - last_refresh_millis;
+  if(refresh_running || refreshed_store != NULL || since_refresh >= REFRESH_INTERVAL_MS)
+    return;
+  for(int n=0; n<n_buttons; n++){
+    if(digitalRead(button_pins[n]) == LOW)
+      return;
+    gpio_wakeup_enable((gpio_num_t)button_pins[n], GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)(REFRESH_INTERVAL_MS - since_refresh) * 1000ULL);
+  WiFi.mode(WIFI_OFF);
+  M5.Lcd.setBrightness(0);
+  Serial.flush();
+  esp_light_sleep_start();
+  M5.Lcd.setBrightness(20);
+  // the task ticks do not advance during the sleep
+  // let the refresh task check the time
+  xTaskNotifyGive(refresh_task_handle);
+#endif
 }
 
 //==============================================================
@@ -652,234 +1626,2021 @@ const char *formatNumber (int value, char *buffer, int len) {
     return endOfbuffer;
 }
 
-//==============================================================
-// A String-Replace function...
-// from:
-// https://stackoverflow.com/questions/5878775/how-to-find-and-replace-string
-void ReplaceStringInPlace(std::string& subject, const std::string& search,
-                          const std::string& replace) {
-    size_t pos = 0;
-    while ((pos = subject.find(search, pos)) != std::string::npos) {
-         subject.replace(pos, search.length(), replace);
-         pos += replace.length();
-    }
-}
-
 //==============================================================
 // Clear the entire screen and add one row
 // The added row is important. Otherwise the first row is not visible
 void Clear_Screen(){
   M5.Lcd.fillScreen(BLACK);
+  invalidate_list();
   M5.Lcd.setCursor(0, 0);
   M5.Lcd.println("");
 }
 
 //==============================================================
-// receive the JSON file from the server
-// go through the file line by line
-// search for keywords and sum the values
-int process_data(){
-  // Number of lines received from the server and processed
-  int line_count = 0;
-  // total number of countries found in the JSON file
-  int countries_found = 0;
-  for(int n=0; n<6; n++)
-    data_count[n] = 0;
-  // strings to hold the received data
-  std::string rcv_line = "";
-  std::string analyze_line = "";
+// Start to show the progress of the current file
+// The progress task is started with the first download.
+// Call progress_end() before anything else is drawn.
+void progress_begin(const char *label){
+  // the file starts now
+  stream_bytes = 0;
+  if(progress_task_handle == NULL){
+    progress_done = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(progress_task, "progress", PROGRESS_TASK_STACK, NULL, 1, &progress_task_handle, 0);
+  }
+  progress_label = label;
+  progress_start_millis = millis();
+  progress_active = true;
+  xTaskNotifyGive(progress_task_handle);
+}
+
+//==============================================================
+// Stop the progress of the current file
+// returns after the progress task has drawn the final state
+void progress_end(){
+  if(!progress_active)
+    return;
+  progress_stops++;
+  progress_active = false;
+  xTaskNotifyGive(progress_task_handle);
+  xSemaphoreTake(progress_done, portMAX_DELAY);
+}
+
+//==============================================================
+// Draw the progress every PROGRESS_INTERVAL_MS while a file is
+// received. The task is woken up early by progress_end().
+// A short file can end before the task wakes up for its start,
+// then the stop is answered without drawing.
+void progress_task(void * parameter){
+  unsigned long answered_stops = 0;
+  while(true){
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if(progress_active){
+      draw_progress(true);
+      while(progress_active){
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PROGRESS_INTERVAL_MS));
+        draw_progress(false);
+      }
+    }
+    // a wake up without a new stop is left over from the last file
+    if(answered_stops != progress_stops){
+      answered_stops = progress_stops;
+      xSemaphoreGive(progress_done);
+    }
+  }
+}
+
+//==============================================================
+// Draw the bar, the received bytes, the throughput and the
+// remaining time of the current file
+// The bar needs the Content-Length, without it only the
+// received bytes and the throughput are shown.
+void draw_progress(bool first){
+  unsigned long bytes = stream_bytes;
+  unsigned long length = stream_length;
+  unsigned long ms = std::max(millis() - progress_start_millis, 1UL);
+  if(first){
+    Clear_Screen();
+    M5.Lcd.setTextDatum(TC_DATUM);
+    M5.Lcd.setFreeFont(FF1);
+    M5.Lcd.setTextColor(WHITE);
+    M5.Lcd.drawString(progress_label, (int)(M5.Lcd.width()/2), PROGRESS_BAR_Y-30, 1);
+    M5.Lcd.drawRect(PROGRESS_BAR_X-2, PROGRESS_BAR_Y-2, PROGRESS_BAR_WIDTH+4, PROGRESS_BAR_HEIGHT+4, WHITE);
+    progress_drawn = 0;
+  }
+  // the grown part of the bar
+  if(length > 0){
+    int filled = (uint64_t)std::min(bytes, length) * PROGRESS_BAR_WIDTH / length;
+    if(filled > progress_drawn){
+      M5.Lcd.fillRect(PROGRESS_BAR_X+progress_drawn, PROGRESS_BAR_Y, filled-progress_drawn, PROGRESS_BAR_HEIGHT, GREEN);
+      progress_drawn = filled;
+    }
+  }
+  // the text lines overwrite their old text with the background
+  char text[48];
+  if(length > 0)
+    snprintf(text, sizeof(text), "%lu of %lu kB", bytes/1024, length/1024);
+  else
+    snprintf(text, sizeof(text), "%lu kB", bytes/1024);
+  M5.Lcd.setTextDatum(TC_DATUM);
+  M5.Lcd.setTextColor(WHITE, BLACK);
+  M5.Lcd.setTextPadding(PROGRESS_BAR_WIDTH);
+  M5.Lcd.drawString(text, (int)(M5.Lcd.width()/2), PROGRESS_BAR_Y+PROGRESS_BAR_HEIGHT+8, 2);
+  // bytes per ms = kB/s
+  if(length > 0 && bytes > 0 && bytes < length)
+    snprintf(text, sizeof(text), "%lu kB/s, %lu s left", bytes/ms, 
+             (unsigned long)((uint64_t)(length-bytes)*ms/bytes/1000));
+  else
+    snprintf(text, sizeof(text), "%lu kB/s", bytes/ms);
+  M5.Lcd.drawString(text, (int)(M5.Lcd.width()/2), PROGRESS_BAR_Y+PROGRESS_BAR_HEIGHT+28, 2);
+  M5.Lcd.setTextPadding(0);
+  M5.Lcd.setTextColor(WHITE);
+}
+
+//==============================================================
+// Send the HTTP request for a file and skip the header
+// The Content-Length of the file is stored in stream_length
+// (0 if the server does not send it).
+// returns false if the connection to the server failed
+bool request_data(const char *server, const char *path){
+  stream_length = 0;
+  arena_reset();
+  if (!client.connect(server, 443))
+    return false;
+  // Make a HTTP request:
+  char request_line[192];
+  snprintf(request_line, sizeof(request_line), "GET https://%s%s HTTP/1.0", server, path);
+  client.println(request_line);
+  snprintf(request_line, sizeof(request_line), "Host: %s", server);
+  client.println(request_line);
+  client.println("Connection: close");
+  client.println();
   // skip the header data
+  // the rest of a too long header line is read as the next line
+  char *header_line = (char*)arena_alloc(PARSE_HEADER_LENGTH);
+  if(header_line == NULL)
+    return false;
   while (client.connected()) {
-    rcv_line = client.readStringUntil('\n').c_str();
-    if (rcv_line == "\r") {
-      M5.Lcd.println("[OK] header received");
+    size_t length = client.readBytesUntil('\n', header_line, PARSE_HEADER_LENGTH-1);
+    header_line[length] = 0;
+    if (strcmp(header_line, "\r") == 0)
       break;
-    }
+    if (strncasecmp(header_line, "Content-Length:", 15) == 0)
+      stream_length = strtoul(header_line+15, NULL, 10);
   }
-  // Index of a found country section
-  // Country_index = 0 --> looking for a configured countrie
-  // Country_index > 0 --> country found. collecting data
-  int Country_index = 0;
+  return true;
+}
 
-  // Basic format information from the JSOM data:
-  // Country START string:
-  // "  \"Germany\": [\n"
-  // Country END string:
-  // "  ],\n" or "  ]\n"
-  // value strings:
-  // "      \"confirmed\": 0,\n"
-  // "      \"deaths\": 0,\n"
-  // "      \"recovered\": 0\n"
-  
-  // if there are incoming bytes available
-  while (client.available()) {
-    // get one line from the server data
-    rcv_line = client.readStringUntil('\n').c_str();
+//==============================================================
+// Data source: JSON file of pomber
+// returns false if the connection to the server failed
+bool load_json(series_store_t *target, bool show_progress){
+  if (!request_data(data_server_name, data_path))
+    return false;
+  if(show_progress){
+    M5.Lcd.println("[OK] Connected to server");
+    M5.Lcd.println("[OK] header received");
+  }
+  // get the JSON data from the github server
+  // and calculate the values
+  if(show_progress)
+    progress_begin(data_sources[data_source].name);
+  process_data(client, target);
+  progress_end();
+  // close the connection to the server
+  client.stop();
+  return true;
+}
 
-    // looking for the "country seperator"
-    // only to display the percentage on the screen
-    if (rcv_line.find(": [", 0)  != std::string::npos){ 
-      // count the overall number of countries
-      countries_found++;
-      // the data from all countries should summed up
-      data_count[0] = 0;
-      // print the percentage of processing
-      Clear_Screen();
-      M5.Lcd.setTextDatum(CC_DATUM);
-      M5.Lcd.setFreeFont(FF3);
-      char text_buffer[32];
-      snprintf(text_buffer, sizeof(text_buffer), "%3.0f%%",
-              (100.0/max_number_countries)*countries_found);
-      M5.Lcd.drawString(text_buffer, (int)(M5.Lcd.width()/2), (int)(M5.Lcd.height()/2), 1);
-    }
-    // count the number of confirmed, deaths and recovered over all countries
-    // looking for a "confirmed" data line
-    if (rcv_line.find("confirmed", 0)  != std::string::npos){
-      analyze_line = rcv_line;
-      // delete everything out of the string exept the number
-      ReplaceStringInPlace(analyze_line, "      \"confirmed\": ", "");
-      ReplaceStringInPlace(analyze_line, ",", "");
-      ReplaceStringInPlace(analyze_line, "\n", "");
-      int value = atoi(analyze_line.c_str());
-      // add the value to the "All countries" Array
-      collected_data[0][0][data_count[0]] = collected_data[0][0][data_count[0]] + value;
-      // if we are inside an configure country section, set the value inside the Array
-      if(Country_index > 0){
-        collected_data[0][Country_index][data_count[Country_index]] = value;
-      }
-      // if country is part of europe, add the value
-      if(part_of_europe){
-        collected_data[0][1][data_count[1]] = collected_data[0][1][data_count[1]] + value;
+//==============================================================
+// Data source: CSV files of JHU
+// The confirmed file is parsed first, then the deaths file.
+// Both build the leaderboard of their metric. A leaderboard entry
+// that is not found in the other leaderboards or the country list
+// misses the values of the other metric. For these entries the
+// confirmed file is parsed a second time.
+// returns false if the connection to the server failed
+bool load_csv(series_store_t *target, bool show_progress){
+  // metric and leaderboard of every pass
+  const int passes[3][2] = {{0, 1}, {1, 1}, {0, 0}};
+  csv_begin(target);
+  for(int p=0; p<3; p++){
+    int metric = passes[p][0];
+    bool rank = passes[p][1];
+    if(!rank && !csv_missing(metric))
+      break;
+    if (!request_data(csv_server_name, csv_paths[metric]))
+      return false;
+    if(show_progress)
+      M5.Lcd.printf("[OK] %s received\n", data_name[metric]);
+    if(show_progress)
+      progress_begin(data_name[metric]);
+    process_csv(client, metric, rank);
+    progress_end();
+    client.stop();
+  }
+  csv_finish();
+  return true;
+}
+
+//==============================================================
+// Reset the target store and the CSV state before the first file
+void csv_begin(series_store_t *target){
+  parse_store = target;
+  store_clear(target);
+  sums_clear();
+  memset(csv_filled, 0, sizeof(csv_filled));
+  parse_stats_begin();
+  csv_days = 0;
+  csv_count = 0;
+  csv_last_day = -1;
+  csv_countries = 0;
+  csv_error = false;
+  pool_overflow = false;
+}
+
+//==============================================================
+// receive one CSV file of a metric from the stream
+// Format of a JHU time series file:
+// "Province/State,Country/Region,Lat,Long,1/22/20,1/23/20,...\n"
+// ",Germany,51.165691,10.451526,0,0,...\n"
+// "Australian Capital Territory,Australia,-35.4735,149.0124,0,0,...\n"
+// A row holds the whole history of a country or a province.
+// The rows of the provinces of a country follow each other and are
+// summed up. Only the last SERIES_LENGTH days are kept.
+// metric: 0 = confirmed, 1 = deaths
+// rank: build the leaderboard of the metric and the sums of
+// "All countries" and "Europe" (only once per metric)
+int process_csv(Stream &stream, int metric, bool rank){
+  unsigned long start_us = micros();
+  stream_bytes = 0;
+  int rows = 0;
+  int countries_found = 0;
+  bool header = true;
+  int field = 0;
+  bool in_quotes = false;
+  // text of the current field (country names and dates)
+  char text[LEADERBOARD_NAME_LENGTH];
+  int text_length = 0;
+  int value = 0;
+  bool negative = false;
+  bool fraction = false;
+  int days = 0;
+  // the bytes are read in small blocks to keep the timing cheap
+  char buffer[64];
+  int length = 0;
+  int pos = 0;
+  in_country = false;
+  while(true){
+    if(pos == length){
+      unsigned long read_start_us = micros();
+      length = 0;
+      pos = 0;
+      while(length < (int)sizeof(buffer)){
+        int c = stream_read(stream);
+        if(c < 0)
+          break;
+        buffer[length++] = c;
+        if(c == '\n')
+          break;
       }
+      parse_stats.read_us += micros() - read_start_us;
+      if(length == 0)
+        break;
     }
-    // looking for a "deaths" data line
-    if (rcv_line.find("deaths", 0)  != std::string::npos){
-      analyze_line = rcv_line;
-      // delete everything out of the string exept the number
-      ReplaceStringInPlace(analyze_line, "      \"deaths\": ", "");
-      ReplaceStringInPlace(analyze_line, ",", "");
-      ReplaceStringInPlace(analyze_line, "\n", "");
-      int value = atoi(analyze_line.c_str());
-      // add the value to the "All countries" Array
-      collected_data[1][0][data_count[0]] = collected_data[1][0][data_count[0]] + value;
-      data_count[0]++;
-      // Array can contain maximum SCREEN_WIDTH datapoints
-      if(data_count[0] >= SCREEN_WIDTH)
-        data_count[0] = 0;
-      // if we are inside an configure country section
-      if(Country_index > 0){
-        collected_data[1][Country_index][data_count[Country_index]] = value;
-        data_count[Country_index]++;
-        if(data_count[Country_index] >= SCREEN_WIDTH)
-          data_count[Country_index] = 0;
-      }
-      // if country is part of europe, add the value to the Europe Array
-      if(part_of_europe){
-        collected_data[1][1][data_count[1]] = collected_data[1][1][data_count[1]] + value;
-        data_count[1]++;
-        if(data_count[1] >= SCREEN_WIDTH){
-          data_count[1] = 0;}
-      }
+    char c = buffer[pos++];
+    if(in_quotes){
+      if(c == '"')
+        in_quotes = false;
+      else if(text_length < LEADERBOARD_NAME_LENGTH-1)
+        text[text_length++] = c;
+      continue;
     }
-    // store the last "date" line to get the last actualization date
-    // looking for a "date" data line
-    if (rcv_line.find("date", 0)  != std::string::npos){
-      last_date = rcv_line;
-    }
-    // if outside an country section
-    if(Country_index == 0) {
-      // check if country is part of the country list
-      for(int n=2; n<n_countries; n++){
-        if (rcv_line.find(country_names[n].c_str(), 0)  != std::string::npos){
-          Country_index = n;
-          // reset the data point counter so that it starts always
-          // with the first day
-          data_count[0] = 0;
+    if(c == '"'){
+      in_quotes = true;
+    } else if(c == ',' || c == '\n'){
+      // END of a field
+      text[text_length] = 0;
+      if(header){
+        if(field >= 4){
+          days++;
+          // the last date of the header is the date of the data
+          if(c == '\n'){
+            int day = csv_day(text);
+            if(csv_last_day < 0)
+              csv_last_day = day;
+            if(day < 0 || day != csv_last_day)
+              csv_error = true;
+          }
         }
-      }
-      // check for country as part of europe
-      for(int n=1; n<n_europe_countries; n++){
-        if (rcv_line.find(europe_names[n].c_str(), 0)  != std::string::npos){
-          part_of_europe = true;
-          data_count[1] = 0;
+      } else if(field == 1){
+        // JHU marks some country names with a '*'
+        if(text_length > 0 && text[text_length-1] == '*')
+          text[text_length-1] = 0;
+        if(!in_country || strcmp(text, current_country) != 0){
+          // the provinces of the last country are complete
+          if(in_country){
+            unsigned long store_start_us = micros();
+            csv_end_country(metric, rank);
+            parse_stats.store_us += micros() - store_start_us;
+          }
+          strcpy(current_country, text);
+          memset(current_data, 0, sizeof(current_data));
+          in_country = true;
+          countries_found++;
+          parse_stats_heap();
+        }
+      } else if(field >= 4){
+        // position of the day inside the last SERIES_LENGTH days
+        int day = field - 4;
+        int p = day - (csv_days - csv_count);
+        if(day < csv_days && p >= 0){
+          int sum = current_data[metric][p] + (negative ? -value : value);
+          current_data[metric][p] = std::max(std::min(sum, CSV_MAX_VALUE), -CSV_MAX_VALUE);
         }
       }
-    }
-    if(Country_index > 0 || part_of_europe) {
-      // otherwise check for END of country-section
-      if (rcv_line.find("]", 0)  != std::string::npos){
-        Country_index = 0;
-        part_of_europe = false;
+      text_length = 0;
+      value = 0;
+      negative = false;
+      fraction = false;
+      field++;
+      if(c == '\n'){
+        if(header){
+          header = false;
+          // all files must have the same days
+          if(csv_days == 0){
+            csv_days = days;
+            csv_count = std::min(days, SERIES_LENGTH);
+            // the stored days start at ring position 0
+            ring_base = csv_last_day - csv_count + 1;
+          }
+          if(days == 0 || days != csv_days)
+            csv_error = true;
+        } else {
+          if(field != csv_days + 4)
+            csv_error = true;
+          rows++;
+        }
+        field = 0;
       }
-    }
-    line_count++;
-    // Sometimes, we need to wait for new data from the server
-    // to not exit the loop before all data are received
-    // Last data line is "}"
-    for(int n=0; n<10; n++){
-      if (!client.available() && rcv_line != "}"){
-        delay(550);
+    } else if(c != '\r'){
+      if(text_length < LEADERBOARD_NAME_LENGTH-1)
+        text[text_length++] = c;
+      if(field >= 4 && !header){
+        if(c >= '0' && c <= '9'){
+          if(!fraction)
+            value = value < CSV_MAX_VALUE/10 ? value*10 + (c - '0') : CSV_MAX_VALUE;
+        } else if(c == '.'){
+          fraction = true;
+        } else if(c == '-'){
+          negative = true;
+        }
       }
     }
   }
-  // delete everything out of the last_date string exept the date
-  ReplaceStringInPlace(last_date, "      \"date\": \"", "");
-  ReplaceStringInPlace(last_date, "\",", "");
-  ReplaceStringInPlace(last_date, "\n", "");
-  return line_count;
+  // the file ends inside a row
+  if(field > 0 || header)
+    csv_error = true;
+  // the file is shorter than announced by the server
+  if(stream_length > 0 && stream_bytes < stream_length)
+    csv_error = true;
+  if(in_country){
+    unsigned long store_start_us = micros();
+    csv_end_country(metric, rank);
+    parse_stats.store_us += micros() - store_start_us;
+  }
+  if(rank)
+    csv_countries = std::max(csv_countries, countries_found);
+  parse_stats.records += rows;
+  parse_stats.total_us += micros() - start_us;
+  return rows;
 }
 
 //==============================================================
-// display the data as curves / graphs including a legend
-void display_data_graph(int data_select){
-  print_menu(4);
-  delay(200);
-  M5.Lcd.fillScreen(BLACK);
-  int selected_country;
-  // get maximum value to scale the y-axis
-  int max_y = 0;
-  for(int n=1; n<6; n++){
-    selected_country = country_selection[n];
-    for(int i = 0; i < data_count[selected_country]; i++){
-      if(collected_data[data_select-1][selected_country][i] > max_y)
-        max_y = collected_data[data_select-1][selected_country][i];
+// All rows of the current country are summed up
+// Store the metric into the series of the country list and the
+// leaderboard with the same name and add the country to the
+// leaderboard of the metric.
+void csv_end_country(int metric, bool rank){
+  in_country = false;
+  int count = csv_count;
+  if(count == 0)
+    return;
+  int other = 1 - metric;
+  // the rows cover the same days, the position p is the day ring_base+p
+  current_first_day = ring_base;
+  current_day = ring_base + count - 1;
+  if(rank){
+    bool europe = is_europe(current_country);
+    for(int p=0; p<count; p++){
+      sum_add(0, metric, ring_base+p, current_data[metric][p]);
+      if(europe)
+        sum_add(1, metric, ring_base+p, current_data[metric][p]);
     }
   }
-  // draw weekly grid lines
-  // start from the end and go backwards
-  int xpos = data_count[country_selection[1]]-7;
-  float x_scale = float(SCREEN_WIDTH) / data_count[1];
-  while(xpos > 0){
-    M5.Lcd.drawLine(trunc(x_scale*xpos), 0, trunc(x_scale*xpos), (SCREEN_HEIGHT-1), 0x528A);
-    xpos = xpos -7;
+  // the values of the other metric are taken out of the store
+  bool other_known = false;
+  for(int s=2; s<n_series && !other_known; s++){
+    if(csv_filled[s][other] && strcmp(parse_series_name(s), current_country) == 0){
+      load_series(parse_store, s, other, current_data[other]);
+      other_known = true;
+    }
   }
-  // draw line graph
-  for(int n=1; n<6; n++){
-    selected_country = country_selection[n];
-    x_scale = float(SCREEN_WIDTH) / data_count[selected_country];
-    for(int i = 1; i < data_count[selected_country]; i++){
-      M5.Lcd.drawLine(trunc(x_scale*(i-1)), 
-                      (SCREEN_HEIGHT-1)-(round((float((SCREEN_HEIGHT-1)) / max_y) * collected_data[data_select-1][selected_country][i-1])), 
-                      trunc(x_scale*i), 
-                      (SCREEN_HEIGHT-1)-(round((float((SCREEN_HEIGHT-1)) / max_y) * collected_data[data_select-1][selected_country][i])), 
-                      country_color[n]);
+  for(int s=2; s<n_series; s++){
+    if(!csv_filled[s][metric] && strcmp(parse_series_name(s), current_country) == 0){
+      store_current(parse_store, s);
+      csv_filled[s][metric] = true;
+      csv_filled[s][other] = other_known;
     }
   }
-  // draw legend
-  M5.Lcd.setFreeFont(FF1);
-  M5.Lcd.setCursor(0, 0);
+  if(!rank)
+    return;
+  // the leaderboard takes the data out of current_data
+  int board[2];
+  int value[2];
+  int n = 0;
+  if(metric == 0){
+    // new confirmed cases in the last 7 days
+    int confirmed = current_data[0][count-1];
+    board[n] = 0;
+    value[n++] = confirmed;
+    board[n] = 2;
+    value[n++] = count > 7 ? confirmed - current_data[0][count-8] : confirmed;
+  } else {
+    board[n] = 1;
+    value[n++] = current_data[1][count-1];
+  }
+  for(int i=0; i<n; i++){
+    int s = leaderboard_insert(board[i], value[i]);
+    if(s >= 0){
+      csv_filled[s][metric] = true;
+      csv_filled[s][other] = other_known;
+    }
+  }
+}
+
+//==============================================================
+// true if a leaderboard entry misses the values of a metric
+bool csv_missing(int metric){
+  for(int s=n_countries; s<n_series; s++){
+    if(!csv_filled[s][metric] && strcmp(parse_series_name(s), "-") != 0)
+      return true;
+  }
+  return false;
+}
+
+//==============================================================
+// Store the sums and sort the leaderboard after the last file
+void csv_finish(){
+  unsigned long store_start_us = micros();
+  store_sums(parse_store);
+  leaderboard_sort();
+  parse_stats.store_us += micros() - store_start_us;
+  parse_store->valid = (!csv_error && csv_countries > 0);
+}
+
+//==============================================================
+// Epoch day of a date of the CSV header
+// "10/3/20" --> 18538, -1 if the text is not a date
+int csv_day(const char *text){
+  int month, day, year;
+  if(sscanf(text, "%d/%d/%d", &month, &day, &year) != 3)
+    return -1;
+  return epoch_day(year < 100 ? 2000+year : year, month, day);
+}
+
+//==============================================================
+// Days since 1970-01-01 of a date
+// -1 for dates outside of 2000..2099 (the days must fit into 16 bit)
+int epoch_day(int year, int month, int day){
+  if(year < 2000 || year > 2099 || month < 1 || month > 12 || day < 1 || day > 31)
+    return -1;
+  // the year starts in March, so the leap day is the last day
+  if(month <= 2)
+    year--;
+  int year_of_era = year - 1600;
+  int day_of_year = (153*(month > 2 ? month-3 : month+9) + 2)/5 + day-1;
+  int days = year_of_era*365 + year_of_era/4 - year_of_era/100 + year_of_era/400 + day_of_year;
+  // 1600-03-01 to 1970-01-01
+  return days - 135080;
+}
+
+//==============================================================
+// Date of an epoch day in the format of the JSON file
+// 18538 --> "2020-10-3"
+void format_date(int day, char *buffer, int len){
+  int year, month, day_of_month;
+  split_date(day, year, month, day_of_month);
+  snprintf(buffer, len, "%i-%i-%i", year, month, day_of_month);
+}
+
+//==============================================================
+// Year, month and day of the month of an epoch day
+void split_date(int day, int &year, int &month, int &day_of_month){
+  // days since 1600-03-01, the calendar repeats every 400 years
+  int days = day + 135080;
+  int era = days / 146097;
+  int day_of_era = days - era*146097;
+  int year_of_era = (day_of_era - day_of_era/1460 + day_of_era/36524 - day_of_era/146096) / 365;
+  year = 1600 + era*400 + year_of_era;
+  int day_of_year = day_of_era - (365*year_of_era + year_of_era/4 - year_of_era/100);
+  month = (5*day_of_year + 2)/153;
+  day_of_month = day_of_year - (153*month + 2)/5 + 1;
+  month = month < 10 ? month+3 : month-9;
+  if(month <= 2)
+    year++;
+}
+
+//==============================================================
+// Epoch day of a "date" record of the JSON file
+// "      \"date\": \"2020-1-22\"" --> 18283, -1 if there is no date
+int record_date(const record_t &record){
+  char text[16];
+  record_text(record, text, sizeof(text));
+  int year, month, day;
+  if(sscanf(text, "%d-%d-%d", &year, &month, &day) != 3)
+    return -1;
+  return epoch_day(year, month, day);
+}
+
+//==============================================================
+// Print the free heap and the largest free block over Serial
+void log_heap(const char *label){
+  Serial.printf("[HEAP] %s: free %u, largest block %u, min free %u\n", label,
+                (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+                (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+}
+
+//==============================================================
+// Entry of a country inside the catalog (binary search)
+// returns NULL if the country is not part of the catalog
+const catalog_entry_t* find_catalog(const char* name){
+  int low = 0;
+  int high = n_catalog_countries-1;
+  while(low <= high){
+    int middle = (low + high)/2;
+    int order = strcmp(name, country_catalog[middle].name);
+    if(order == 0)
+      return &country_catalog[middle];
+    if(order < 0)
+      high = middle-1;
+    else
+      low = middle+1;
+  }
+  return NULL;
+}
+
+//==============================================================
+// Index of a country inside the country list
+// returns 0 if the country is not part of the list
+int find_country(const char* name){
+  const catalog_entry_t *entry = find_catalog(name);
+  return entry != NULL ? entry->country : 0;
+}
+
+//==============================================================
+// true if the country is part of Europe
+bool is_europe(const char* name){
+  const catalog_entry_t *entry = find_catalog(name);
+  return entry != NULL && entry->europe;
+}
+
+//==============================================================
+// Name of a country or a leaderboard entry of the parse store
+const char* parse_series_name(int index){
+  if(index < n_countries)
+    return country_names[index];
+  return parse_store->leaderboard_names[index-n_countries];
+}
+
+
+//==============================================================
+// receive the JSON file from the stream
+// go through the file record by record
+// search for keywords and sum the values
+// The data is stored inside the target store.
+int process_data(Stream &stream, series_store_t *target){
+  unsigned long start_us = micros();
+  stream_bytes = 0;
+  // Number of records received from the server and processed
+  int line_count = 0;
+  // total number of countries found in the JSON file
+  int countries_found = 0;
+  parse_store = target;
+  store_clear(target);
+  sums_clear();
+  ring_base = 0;
+  in_country = false;
+  part_of_europe = false;
+  pool_overflow = false;
+  json_depth = 0;
+  json_in_string = false;
+  json_escape = false;
+  json_complete = false;
+  parse_stats_begin();
+  // the record is taken out of the arena, the header is not needed anymore
+  arena_reset();
+  record_t rcv_line;
+  rcv_line.text = (char*)arena_alloc(PARSE_RECORD_LENGTH+1);
+  rcv_line.length = 0;
+  if(rcv_line.text == NULL)
+    return 0;
+  // Index of a found country section
+  // Country_index = 0 --> looking for a configured countrie
+  // Country_index > 0 --> country found. collecting data
+  int Country_index = 0;
+
+  // Basic format information from the JSOM data:
+  // Country START string:
+  // "  \"Germany\": [\n"
+  // Country END string:
+  // "  ],\n" or "  ]\n"
+  // value strings:
+  // "      \"confirmed\": 0,\n"
+  // "      \"deaths\": 0,\n"
+  // "      \"recovered\": 0\n"
+  // The minified form of the file has the same records without
+  // spaces and line breaks:
+  // "\"Germany\":[{\"date\":\"2020-1-22\"" "\"confirmed\":0" ...
+  
+  // get one record after the other from the server data
+  while (true) {
+    unsigned long read_start_us = micros();
+    bool received = read_record(stream, rcv_line);
+    parse_stats.read_us += micros() - read_start_us;
+    if(!received)
+      break;
+    parse_stats.records++;
+
+    // looking for the "country seperator"
+    if (strchr(rcv_line.text, '[') != NULL){ 
+      // count the overall number of countries
+      countries_found++;
+      // the heap is checked once per country
+      parse_stats_heap();
+      // every country is collected and a candidate for the leaderboard
+      start_country(rcv_line.text);
+      // check if country is part of the country list and of europe
+      Country_index = find_country(current_country);
+      part_of_europe = is_europe(current_country);
+    }
+    // count the number of confirmed, deaths and recovered over all countries
+    // looking for a "confirmed" data line
+    if (strstr(rcv_line.text, "confirmed") != NULL){
+      int value = record_number(rcv_line);
+      add_value(0, value);
+    }
+    // looking for a "deaths" data line
+    if (strstr(rcv_line.text, "deaths") != NULL){
+      int value = record_number(rcv_line);
+      add_value(1, value);
+    }
+    // the values of a new day follow
+    // looking for a "date" data line
+    if (strstr(rcv_line.text, "date") != NULL){
+      int day = record_date(rcv_line);
+      if(day >= 0)
+        set_day(day);
+    }
+    // END of a country-section
+    if(in_country && strchr(rcv_line.text, ']') != NULL){
+      unsigned long store_start_us = micros();
+      end_country(Country_index);
+      parse_stats.store_us += micros() - store_start_us;
+    }
+    if(Country_index > 0 || part_of_europe) {
+      // otherwise check for END of country-section
+      if (strchr(rcv_line.text, ']') != NULL){
+        Country_index = 0;
+        part_of_europe = false;
+      }
+    }
+    line_count++;
+  }
+  // store the sums of "All countries" and "Europe"
+  unsigned long store_start_us = micros();
+  store_sums(target);
+  // sort the leaderboard by rank
+  leaderboard_sort();
+  parse_stats.store_us += micros() - store_start_us;
+  // the file is complete if the outermost object was closed
+  target->valid = (json_complete && countries_found > 0);
+  parse_stats.total_us = micros() - start_us;
+  return line_count;
+}
+
+//==============================================================
+// Read the next record of the JSON file from the stream
+// A record ends at a line break or at a comma outside of a string.
+// Empty records are skipped. returns false at the end of the file
+// or if no data was received for parse_timeout_ms.
+bool read_record(Stream &stream, record_t &record){
+  record.length = 0;
+  record.text[0] = 0;
+  bool received = false;
+  while(!json_complete){
+    int c = stream_read(stream);
+    if(c < 0)
+      break;
+    if(json_in_string){
+      if(json_escape)
+        json_escape = false;
+      else if(c == '\\')
+        json_escape = true;
+      else if(c == '"')
+        json_in_string = false;
+    } else if(c == '"'){
+      json_in_string = true;
+    } else if(c == '{' || c == '['){
+      json_depth++;
+    } else if(c == '}' || c == ']'){
+      json_depth--;
+      if(json_depth <= 0)
+        json_complete = true;
+    } else if(c == ',' || c == '\n'){
+      if(record.length == 0)
+        continue;
+      return true;
+    }
+    received = true;
+    // the rest of a too long record is dropped
+    if(record.length < PARSE_RECORD_LENGTH){
+      record.text[record.length++] = c;
+      record.text[record.length] = 0;
+    }
+  }
+  return received;
+}
+
+//==============================================================
+// Read one byte of a file from the stream
+// Sometimes, we need to wait for new data from the server
+// to not exit before all data are received.
+// returns -1 at the end of the file or if no data was received
+// for parse_timeout_ms
+int stream_read(Stream &stream){
+  if(stream_length > 0 && stream_bytes >= stream_length)
+    return -1;
+  int c = stream.read();
+  if(c < 0){
+    unsigned long wait_start = millis();
+    while(c < 0 && millis() - wait_start < parse_timeout_ms){
+      delay(1);
+      c = stream.read();
+    }
+    if(c < 0)
+      return -1;
+  }
+  stream_bytes++;
+  parse_stats.bytes++;
+  return c;
+}
+
+//==============================================================
+// Number behind the last colon of a record
+// "      \"confirmed\": 1234" --> 1234
+int record_number(const record_t &record){
+  const char *colon = strrchr(record.text, ':');
+  if(colon == NULL)
+    return 0;
+  return atoi(colon+1);
+}
+
+//==============================================================
+// Quoted text behind the last colon of a record
+// "      \"date\": \"2020-1-22\"" --> 2020-1-22
+void record_text(const record_t &record, char *buffer, int len){
+  int n = 0;
+  const char *pos = strrchr(record.text, ':');
+  if(pos != NULL){
+    pos = strchr(pos, '"');
+    if(pos != NULL){
+      pos++;
+      while(*pos != 0 && *pos != '"' && n < len-1)
+        buffer[n++] = *pos++;
+    }
+  }
+  buffer[n] = 0;
+}
+
+//==============================================================
+// Take a block out of the parse arena
+// The blocks are 4 byte aligned and are freed all at once by
+// arena_reset(). returns NULL if the arena is full.
+void *arena_alloc(size_t size){
+  size = (size + 3) & ~(size_t)3;
+  if(size > PARSE_ARENA_SIZE - parse_arena.used){
+    parse_arena.failed++;
+    return NULL;
+  }
+  void *block = parse_arena.memory + parse_arena.used;
+  parse_arena.used += size;
+  parse_arena.allocations++;
+  parse_arena.high_water = std::max(parse_arena.high_water, parse_arena.used);
+  return block;
+}
+
+//==============================================================
+// Free all blocks of the parse arena
+void arena_reset(){
+  parse_arena.used = 0;
+}
+
+//==============================================================
+// Reset the timing and memory statistics of a parse
+void parse_stats_begin(){
+  memset(&parse_stats, 0, sizeof(parse_stats));
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  parse_stats.start_blocks = info.allocated_blocks;
+  parse_stats.min_free_heap = info.total_free_bytes;
+  parse_stats.min_largest_block = info.largest_free_block;
+}
+
+//==============================================================
+// Check the heap during a parse (once per country)
+void parse_stats_heap(){
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  parse_stats.min_free_heap = std::min(parse_stats.min_free_heap, info.total_free_bytes);
+  parse_stats.min_largest_block = std::min(parse_stats.min_largest_block, info.largest_free_block);
+  parse_stats.heap_blocks = std::max(parse_stats.heap_blocks,
+                                     (int)info.allocated_blocks - (int)parse_stats.start_blocks);
+}
+
+//==============================================================
+// Print the statistics of the last parse over Serial
+void log_parse_stats(const char *label){
+  Serial.printf("[PARSE] %s: %lu records, %lu bytes (read %lu ms, store %lu ms)\n", label,
+                parse_stats.records, parse_stats.bytes, parse_stats.read_us/1000,
+                parse_stats.store_us/1000);
+  Serial.printf("[PARSE] %s: heap blocks +%i, min free %u, min largest block %u, arena %u/%u bytes, %lu allocations, %lu failed\n",
+                label, parse_stats.heap_blocks, (unsigned)parse_stats.min_free_heap,
+                (unsigned)parse_stats.min_largest_block, (unsigned)parse_arena.high_water,
+                PARSE_ARENA_SIZE, parse_arena.allocations, parse_arena.failed);
+}
+
+//==============================================================
+// Wait for the next background refresh
+// The task is notified after a light sleep, because the
+// timeout does not advance during the sleep.
+void refresh_task(void * parameter){
+  while(true){
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(60000));
+    if(millis() - last_refresh_millis >= REFRESH_INTERVAL_MS && refreshed_store == NULL)
+      refresh_data();
+  }
+}
+
+//==============================================================
+// Download and parse the JSON file into a shadow store
+// The live store is not touched. If the new data is complete,
+// the UI task is told to swap the stores.
+void refresh_data(){
+  refresh_running = true;
+  last_refresh_millis = millis();
+  // check the memory budget before anything is allocated
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  if(largest < sizeof(series_store_t) || free_heap < sizeof(series_store_t) + REFRESH_TLS_RESERVE){
+    Serial.printf("[ERR] refresh: not enough memory (free %u, largest block %u)\n",
+                  (unsigned)free_heap, (unsigned)largest);
+    // tell the user once, the notice stays until a refresh is done
+    if(!refresh_skipped){
+      refresh_skipped = true;
+      ui_event_t event;
+      event.type = REFRESH_SKIPPED;
+      event.button = 0;
+      event.timestamp_us = micros();
+      xQueueSend(event_queue, &event, 0);
+    }
+    refresh_running = false;
+    return;
+  }
+  series_store_t *shadow = (series_store_t*)malloc(sizeof(series_store_t));
+  if(shadow == NULL){
+    Serial.println("[ERR] refresh: allocation failed");
+    refresh_running = false;
+    return;
+  }
+  // the WiFi is stopped during a light sleep
+  if(WiFi.status() != WL_CONNECTED){
+    WiFi.mode(WIFI_STA);
+    // without a known location the stored configuration is used
+    if(wifi_location >= 0)
+      WiFi.begin(WIFI_ssid[wifi_location], WIFI_password[wifi_location]);
+    else
+      WiFi.begin();
+    for(int n=0; n<40 && WiFi.status() != WL_CONNECTED; n++)
+      delay(250);
+  }
+  unsigned long start_millis = millis();
+  bool valid = false;
+  if(WiFi.status() == WL_CONNECTED && data_sources[data_source].load(shadow, false)){
+    valid = shadow->valid;
+    Serial.printf("[OK] refresh (%s) in %lu ms, minimum free heap %u\n", data_sources[data_source].name,
+                  millis() - start_millis, (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+    log_parse_stats("refresh");
+  } else {
+    Serial.println("[ERR] refresh: connection failed");
+  }
+  if(valid){
+    refresh_skipped = false;
+    refreshed_store = shadow;
+    ui_event_t event;
+    event.type = DATA_REFRESHED;
+    event.button = 0;
+    event.timestamp_us = micros();
+    if(xQueueSend(event_queue, &event, 0) != pdTRUE){
+      refreshed_store = NULL;
+      free(shadow);
+    }
+  } else {
+    Serial.println("[ERR] refresh: incomplete data, keeping the current data");
+    free(shadow);
+  }
+  refresh_running = false;
+}
+
+//==============================================================
+// Replace the live store with the refreshed store
+// and free the old one
+void swap_store(){
+#if defined(SERIES_SERVER)
+  xSemaphoreTake(store_mutex, portMAX_DELAY);
+#endif
+  series_store_t *old_store = store;
+  store = refreshed_store;
+  refreshed_store = NULL;
+#if defined(SERIES_SERVER)
+  // a store retired by an earlier swap that is not sent any more
+  series_store_t *unused_store = NULL;
+  if(retired_store != NULL && retired_store != served_store){
+    unused_store = retired_store;
+    retired_store = NULL;
+  }
+  // the server frees the old store after its response
+  if(old_store == served_store){
+    retired_store = old_store;
+    old_store = NULL;
+  }
+  xSemaphoreGive(store_mutex);
+  free(unused_store);
+#endif
+  free(old_store);
+}
+
+#if defined(SERIES_SERVER)
+//==============================================================
+// Print with HTTP chunked transfer encoding
+// The output is collected in a fixed buffer and sent as one
+// chunk when the buffer is full, so a response of any size
+// needs no more memory than the buffer.
+// HTTP/1.0 knows no chunks: without chunked the buffer is sent
+// as it is and the end of the body is the end of the connection.
+class chunked_writer_t : public Print {
+ public:
+  chunked_writer_t(WiFiClient &http_client, bool chunked) : http_client(http_client), chunked(chunked) {}
+  size_t write(uint8_t c){
+    if(length == SERVER_CHUNK_SIZE)
+      flush_chunk();
+    buffer[length++] = c;
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t size){
+    // large blocks are sent as their own chunk without a copy
+    if(size >= SERVER_CHUNK_SIZE/2){
+      flush_chunk();
+      send_chunk(data, size);
+    } else {
+      for(size_t i=0; i<size; i++)
+        write(data[i]);
+    }
+    return size;
+  }
+  // send the rest and the last (empty) chunk
+  void end(){
+    flush_chunk();
+    if(chunked)
+      http_client.print("0\r\n\r\n");
+  }
+  unsigned long bytes = 0;
+
+ private:
+  WiFiClient &http_client;
+  bool chunked;
+  uint8_t buffer[SERVER_CHUNK_SIZE];
+  size_t length = 0;
+
+  void send_chunk(const uint8_t *data, size_t size){
+    if(size == 0)
+      return;
+    if(chunked)
+      http_client.printf("%x\r\n", (unsigned)size);
+    http_client.write(data, size);
+    if(chunked)
+      http_client.print("\r\n");
+    bytes += size;
+  }
+  void flush_chunk(){
+    send_chunk(buffer, length);
+    length = 0;
+  }
+};
+
+//==============================================================
+// Accept one connection after the other
+// One request per connection (Connection: close).
+void server_task(void * parameter){
+  server.begin();
+  while(true){
+    WiFiClient http_client = server.available();
+    if(!http_client){
+      delay(SERVER_POLL_MS);
+      continue;
+    }
+    serve_request(http_client);
+    http_client.stop();
+  }
+}
+
+//==============================================================
+// Read the request and send the response
+// The response is written directly out of the live store.
+void serve_request(WiFiClient &http_client){
+  unsigned long start = micros();
+  char line[128];
+  if(!read_http_line(http_client, line, sizeof(line)))
+    return;
+  // skip the header lines
+  char header[128];
+  while(read_http_line(http_client, header, sizeof(header)) && header[0] != 0);
+  // "GET /series.json?id=3 HTTP/1.1"
+  // a HTTP/1.0 client gets a HTTP/1.0 response without chunks
+  char *end = strchr(line, ' ');
+  if(end != NULL)
+    end = strchr(end+1, ' ');
+  bool http_10 = (end != NULL && strcmp(end+1, "HTTP/1.0") == 0);
+  const char *version = http_10 ? "HTTP/1.0" : "HTTP/1.1";
+  if(strncmp(line, "GET ", 4) != 0){
+    http_client.printf("%s 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", version);
+    return;
+  }
+  char *path = line+4;
+  if(end != NULL)
+    *end = 0;
+  const char *query = "";
+  char *separator = strchr(path, '?');
+  if(separator != NULL){
+    *separator = 0;
+    query = separator+1;
+  }
+  int format;
+  if(strcmp(path, "/summary.json") == 0)
+    format = 0;
+  else if(strcmp(path, "/series.json") == 0)
+    format = 1;
+  else if(strcmp(path, "/series.bin") == 0)
+    format = 2;
+  else {
+    http_client.printf("%s 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", version);
+    return;
+  }
+  http_client.printf("%s 200 OK\r\nContent-Type: %s\r\n%s"
+                     "Access-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+                     version, format == 2 ? "application/octet-stream" : "application/json",
+                     http_10 ? "" : "Transfer-Encoding: chunked\r\n");
+  chunked_writer_t out(http_client, !http_10);
+  int ids[n_series];
+  // the response is sent from the current live store, even if it
+  // is replaced in the meantime
+  xSemaphoreTake(store_mutex, portMAX_DELAY);
+  const series_store_t *source = store;
+  served_store = source;
+  xSemaphoreGive(store_mutex);
+  int n_ids = select_series(source, query, ids);
+  if(format == 0)
+    send_summary(out, source);
+  else if(format == 1)
+    send_series_json(out, source, ids, n_ids);
+  else
+    send_series_binary(out, source, ids, n_ids);
+  out.end();
+  // free the store if it was replaced during the response
+  xSemaphoreTake(store_mutex, portMAX_DELAY);
+  served_store = NULL;
+  series_store_t *old_store = retired_store;
+  retired_store = NULL;
+  xSemaphoreGive(store_mutex);
+  free(old_store);
+  unsigned long duration = micros() - start;
+  server_stats.requests++;
+  server_stats.bytes += out.bytes;
+  server_stats.busy_us += duration;
+  server_stats.max_us = std::max(server_stats.max_us, duration);
+}
+
+//==============================================================
+// Read one line of the request without the line end
+// Too long lines are truncated. returns false after a timeout.
+bool read_http_line(WiFiClient &http_client, char *line, int len){
+  int n = 0;
+  unsigned long start = millis();
+  while(millis() - start < SERVER_TIMEOUT_MS){
+    int c = http_client.read();
+    if(c < 0){
+      if(!http_client.connected())
+        break;
+      delay(1);
+      continue;
+    }
+    if(c == '\n'){
+      line[n] = 0;
+      return true;
+    }
+    if(c != '\r' && n < len-1)
+      line[n++] = c;
+  }
+  line[n] = 0;
+  return false;
+}
+
+//==============================================================
+// Print a quoted JSON string
+void print_json_string(Print &out, const char *text){
+  out.print('"');
+  for(; *text; text++){
+    if(*text == '"' || *text == '\\')
+      out.print('\\');
+    if((uint8_t)*text >= 0x20)
+      out.print(*text);
+  }
+  out.print('"');
+}
+
+//==============================================================
+// Names, latest values and the leaderboard
+// {"last_date":"2020-10-3","valid":true,
+//  "series":[{"id":0,"name":"All countries","first_date":"2020-1-22","days":256,
+//             "confirmed":123,"deaths":4},...],
+//  "leaderboard":[{"title":"Top confirmed","ids":[31,...],"values":[...]},...]}
+void send_summary(Print &out, const series_store_t *source){
+  out.print("{\"last_date\":");
+  print_json_string(out, source->last_date);
+  out.printf(",\"valid\":%s,\"series\":[", source->valid ? "true" : "false");
+  for(int index=0; index<n_series; index++){
+    const series_t *series = &source->series[index];
+    out.printf("%s{\"id\":%i,\"name\":", index > 0 ? "," : "", index);
+    print_json_string(out, series_name_in(source, index));
+    char first_date[16];
+    format_date(series->first_day, first_date, sizeof(first_date));
+    out.printf(",\"first_date\":\"%s\"", first_date);
+    out.printf(",\"days\":%i,\"confirmed\":%i,\"deaths\":%i}", series->count, series->latest[0], series->latest[1]);
+  }
+  out.print("],\"leaderboard\":[");
+  for(int m=0; m<n_leaderboard_metrics; m++){
+    out.printf("%s{\"title\":", m > 0 ? "," : "");
+    print_json_string(out, leaderboard_title[m]);
+    out.print(",\"ids\":[");
+    for(int r=0; r<source->leaderboard_count[m]; r++)
+      out.printf("%s%i", r > 0 ? "," : "", n_countries + m*LEADERBOARD_SIZE + r);
+    out.print("],\"values\":[");
+    for(int r=0; r<source->leaderboard_count[m]; r++)
+      out.printf("%s%i", r > 0 ? "," : "", source->leaderboard[m][r].value);
+    out.print("]}");
+  }
+  out.print("]}");
+}
+
+//==============================================================
+// Days of the series as JSON
+// {"last_date":"2020-10-3","series":[{"id":2,"name":"Australia",
+//  "first_date":"2020-1-22","confirmed":[...],"deaths":[...]},...]}
+// The values are the days from first_date on without gaps.
+void send_series_json(Print &out, const series_store_t *source, const int *ids, int n_ids){
+  // one decoded series at a time
+  static int values[SERIES_LENGTH];
+  out.print("{\"last_date\":");
+  print_json_string(out, source->last_date);
+  out.print(",\"series\":[");
+  for(int n=0; n<n_ids; n++){
+    out.printf("%s{\"id\":%i,\"name\":", n > 0 ? "," : "", ids[n]);
+    print_json_string(out, series_name_in(source, ids[n]));
+    char first_date[16];
+    format_date(source->series[ids[n]].first_day, first_date, sizeof(first_date));
+    out.printf(",\"first_date\":\"%s\"", first_date);
+    for(int m=0; m<2; m++){
+      load_series(source, ids[n], m, values);
+      out.printf(",\"%s\":[", data_name[m]);
+      for(int i=0; i<source->series[ids[n]].count; i++)
+        out.printf("%s%i", i > 0 ? "," : "", values[i]);
+      out.print("]");
+    }
+    out.print("}");
+  }
+  out.print("]}");
+}
+#endif
+
+//==============================================================
+// Indices of the requested series
+// all series with data, one series (id=<index>)
+// or the selected countries (id=selected)
+int select_series(const series_store_t *source, const char *query, int *ids){
+  int n_ids = 0;
+  if(strcmp(query, "id=selected") == 0){
+    for(int n=0; n<6; n++)
+      ids[n_ids++] = country_selection[n];
+  } else if(strncmp(query, "id=", 3) == 0){
+    int index = atoi(query+3);
+    if(index >= 0 && index < n_series)
+      ids[n_ids++] = index;
+  } else {
+    for(int index=0; index<n_series; index++){
+      if(source->series[index].count > 0)
+        ids[n_ids++] = index;
+    }
+  }
+  return n_ids;
+}
+
+//==============================================================
+// Days of the series in the compact binary form
+// The encoded days are sent directly out of the pool.
+// All numbers are little endian.
+//   "C19S", version (1 byte), last_date (16 bytes), number of series (2 bytes)
+//   for each series:
+//     id (2), days (2), epoch day of the first day (2),
+//     latest confirmed (4), latest deaths (4),
+//     bytes confirmed (2), bytes deaths (2), name length (1), name,
+//     confirmed days, deaths days
+// The days are zigzag varint encoded differences to the previous day
+// (the first day to 0).
+void send_series_binary(Print &out, const series_store_t *source, const int *ids, int n_ids){
+  uint8_t header[23] = {'C', '1', '9', 'S', 1};
+  memcpy(header+5, source->last_date, 16);
+  header[21] = n_ids & 0xFF;
+  header[22] = n_ids >> 8;
+  out.write(header, sizeof(header));
+  for(int n=0; n<n_ids; n++){
+    const series_t *series = &source->series[ids[n]];
+    const char *name = series_name_in(source, ids[n]);
+    uint32_t fields[7] = {(uint32_t)ids[n], series->count, series->first_day, 
+                          (uint32_t)series->latest[0], (uint32_t)series->latest[1],
+                          series->deaths_offset, (uint32_t)(series->bytes - series->deaths_offset)};
+    const int field_size[7] = {2, 2, 2, 4, 4, 2, 2};
+    uint8_t series_header[19];
+    int pos = 0;
+    for(int f=0; f<7; f++){
+      for(int b=0; b<field_size[f]; b++)
+        series_header[pos++] = (fields[f] >> (8*b)) & 0xFF;
+    }
+    series_header[pos++] = strlen(name);
+    out.write(series_header, pos);
+    out.write((const uint8_t*)name, strlen(name));
+    out.write(source->pool + series->offset, series->bytes);
+  }
+}
+
+//==============================================================
+// Print into a large block buffer that is written to a file
+// when it is full. The SD card is much faster with few large
+// writes than with many small ones.
+class block_writer_t : public Print {
+ public:
+  block_writer_t(File &file, uint8_t *buffer, size_t size) : 
+    file(file), buffer(buffer), size(size) {}
+  size_t write(uint8_t c){
+    if(length == size)
+      flush_block();
+    buffer[length++] = c;
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t n){
+    size_t done = 0;
+    while(done < n){
+      if(length == size)
+        flush_block();
+      size_t part = std::min(n - done, size - length);
+      memcpy(buffer + length, data + done, part);
+      length += part;
+      done += part;
+    }
+    return n;
+  }
+  // write the rest, returns false if a write failed
+  bool end(){
+    flush_block();
+    return !failed;
+  }
+  unsigned long bytes = 0;
+
+ private:
+  File &file;
+  uint8_t *buffer;
+  size_t size;
+  size_t length = 0;
+  bool failed = false;
+
+  void flush_block(){
+    if(length > 0 && file.write(buffer, length) != length)
+      failed = true;
+    bytes += length;
+    length = 0;
+  }
+};
+
+//==============================================================
+// Export all series of the live store to the SD card
+// EXPORT_CSV_FILE: one row per series and day, with derived columns
+// EXPORT_BINARY_FILE: the compact binary form of the HTTP server
+// Both files are written through the same block buffer.
+void export_data(){
+  Clear_Screen();
+  M5.Lcd.setFreeFont(FF1);
+  M5.Lcd.setTextColor(WHITE);
+  M5.Lcd.println("Export to SD card...");
+  uint8_t *buffer = (uint8_t*)malloc(EXPORT_BUFFER_SIZE);
+  if(buffer == NULL){
+    M5.Lcd.println("[ERR] not enough memory!");
+    print_menu(menu_state);
+    return;
+  }
+  const char *paths[2] = {EXPORT_CSV_FILE, EXPORT_BINARY_FILE};
+  for(int f=0; f<2; f++){
+    unsigned long bytes, duration_us;
+    if(export_file(paths[f], f == 1, buffer, bytes, duration_us)){
+      unsigned long ms = std::max(duration_us/1000, 1UL);
+      M5.Lcd.printf("[OK] %s\n  %lu kB in %lu ms (%lu kB/s)\n", paths[f], bytes/1024, ms, bytes/ms);
+      Serial.printf("[OK] export %s: %lu bytes in %lu us (%lu bytes/s)\n", paths[f], bytes, duration_us, 
+                    (unsigned long)(1000000ULL*bytes/std::max(duration_us, 1UL)));
+    } else {
+      M5.Lcd.printf("[ERR] unable to write %s\n", paths[f]);
+    }
+  }
+  free(buffer);
+  print_menu(menu_state);
+}
+
+//==============================================================
+// Write one export file, returns false if the file could not be written
+bool export_file(const char *path, bool binary, uint8_t *buffer, unsigned long &bytes, unsigned long &duration_us){
+  unsigned long start = micros();
+  File file = SD.open(path, FILE_WRITE);
+  if(!file)
+    return false;
+  block_writer_t out(file, buffer, EXPORT_BUFFER_SIZE);
+  if(binary){
+    int ids[n_series];
+    int n_ids = select_series(store, "", ids);
+    send_series_binary(out, store, ids, n_ids);
+  } else {
+    export_csv(out);
+  }
+  bool written = out.end();
+  file.close();
+  bytes = out.bytes;
+  duration_us = micros() - start;
+  return written;
+}
+
+//==============================================================
+// All days of all series as CSV
+// "id,name,date,confirmed,deaths,new_confirmed,new_deaths,new_confirmed_7d"
+// "10,Germany,2020-10-3,300619,9578,2639,10,14826"
+// new_*: difference to the day before, new_confirmed_7d: to 7 days before
+// The differences are empty if the series has no such day.
+void export_csv(Print &out){
+  // one decoded series at a time
+  static int values[2][SERIES_LENGTH];
+  out.print("id,name,date,confirmed,deaths,new_confirmed,new_deaths,new_confirmed_7d\n");
+  for(int index=0; index<n_series; index++){
+    const series_t *series = &store->series[index];
+    if(series->count == 0)
+      continue;
+    load_series(store, index, 0, values[0]);
+    load_series(store, index, 1, values[1]);
+    for(int i=0; i<series->count; i++){
+      int year, month, day_of_month;
+      split_date(series->first_day + i, year, month, day_of_month);
+      print_int(out, index);
+      out.print(",\"");
+      out.print(series_name(index));
+      out.print("\",");
+      print_int(out, year);
+      out.print('-');
+      print_int(out, month);
+      out.print('-');
+      print_int(out, day_of_month);
+      const int columns[5] = {values[0][i], values[1][i], 
+                              i > 0 ? values[0][i] - values[0][i-1] : 0,
+                              i > 0 ? values[1][i] - values[1][i-1] : 0,
+                              i > 6 ? values[0][i] - values[0][i-7] : 0};
+      const bool known[5] = {true, true, i > 0, i > 0, i > 6};
+      for(int c=0; c<5; c++){
+        out.print(',');
+        if(known[c])
+          print_int(out, columns[c]);
+      }
+      out.print('\n');
+    }
+  }
+}
+
+//==============================================================
+// Print an integer without the format parsing of printf
+void print_int(Print &out, int value){
+  char digits[12];
+  int n = sizeof(digits);
+  uint32_t rest = value < 0 ? -(uint32_t)value : value;
+  do {
+    digits[--n] = '0' + rest % 10;
+    rest /= 10;
+  } while(rest > 0);
+  if(value < 0)
+    digits[--n] = '-';
+  out.write((const uint8_t*)digits + n, sizeof(digits) - n);
+}
+
+//==============================================================
+// Reset a store before a new JSON file is parsed into it
+void store_clear(series_store_t *target){
+  memset(target->series, 0, sizeof(target->series));
+  for(int m=0; m<n_leaderboard_metrics; m++)
+    target->leaderboard_count[m] = 0;
+  for(int n=0; n<n_leaderboard_metrics*LEADERBOARD_SIZE; n++)
+    strcpy(target->leaderboard_names[n], "-");
+  memset(target->last_date, 0, sizeof(target->last_date));
+  target->valid = false;
+  target->pool_used = 0;
+}
+
+//==============================================================
+// Encode count days of a series into the pool of the target store
+// The days are taken out of the ring buffer data starting at first,
+// first_day is the epoch day of the first of these days.
+// The previous data of the series is dropped. If the pool is full,
+// it is compacted once. If the series does not fit anyway, the
+// oldest days are dropped until it fits (pool_overflow is set).
+// The sums (index 0 and 1) may use the STORE_SUMS_RESERVE at the
+// end of the pool. returns false if days were dropped.
+bool store_series(series_store_t *target, int index, const int data[2][SERIES_LENGTH], int first, int count, int first_day){
+  series_t *series = &target->series[index];
+  series->bytes = 0;
+  series->count = 0;
+  series->latest[0] = 0;
+  series->latest[1] = 0;
+  uint32_t pool_size = (index < 2) ? STORE_POOL_SIZE : STORE_POOL_SIZE - STORE_SUMS_RESERVE;
+  int dropped = 0;
+  for(int attempt=0; ; attempt++){
+    uint32_t pos = target->pool_used;
+    uint32_t deaths_offset = 0;
+    bool fits = true;
+    for(int m=0; m<2 && fits; m++){
+      if(m == 1)
+        deaths_offset = pos - target->pool_used;
+      uint32_t previous = 0;
+      for(int i=0; i<count && fits; i++){
+        uint32_t value = (uint32_t)data[m][(first+i) % SERIES_LENGTH];
+        int32_t delta = (int32_t)(value - previous);
+        // zigzag: small negative and positive differences get small codes
+        uint32_t code = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        previous = value;
+        do {
+          if(pos >= pool_size){
+            fits = false;
+            break;
+          }
+          uint8_t byte = code & 0x7F;
+          code >>= 7;
+          target->pool[pos++] = code ? (byte | 0x80) : byte;
+        } while(code);
+      }
+    }
+    if(fits){
+      series->offset = target->pool_used;
+      series->bytes = pos - target->pool_used;
+      series->deaths_offset = deaths_offset;
+      series->count = count;
+      series->first_day = first_day;
+      if(count > 0){
+        series->latest[0] = data[0][(first+count-1) % SERIES_LENGTH];
+        series->latest[1] = data[1][(first+count-1) % SERIES_LENGTH];
+      }
+      target->pool_used = pos;
+      if(dropped == 0)
+        return true;
+      Serial.printf("[ERR] series store full (%i), %i days dropped\n", index, dropped);
+      pool_overflow = true;
+      return false;
+    }
+    if(attempt == 0){
+      store_compact(target);
+      continue;
+    }
+    // keep the latest days, no days always fit
+    int drop = std::max(count/4, 1);
+    first += drop;
+    first_day += drop;
+    count -= drop;
+    dropped += drop;
+  }
+}
+
+//==============================================================
+// Store the last SERIES_LENGTH days of the current country
+bool store_current(series_store_t *target, int index){
+  if(current_day < 0)
+    return true;
+  int first_day = std::max(current_first_day, current_day - SERIES_LENGTH + 1);
+  return store_series(target, index, current_data, ring_pos(first_day), current_day - first_day + 1, first_day);
+}
+
+//==============================================================
+// Store the sums of "All countries" and "Europe" and the last date
+void store_sums(series_store_t *target){
+  for(int n=0; n<2; n++){
+    if(sum_last_day[n] < 0)
+      continue;
+    int first_day = std::max(sum_first_day[n], sum_last_day[n] - SERIES_LENGTH + 1);
+    store_series(target, n, sum_data[n], ring_pos(first_day), sum_last_day[n] - first_day + 1, first_day);
+  }
+  // the latest day of all countries
+  if(sum_last_day[0] >= 0)
+    format_date(sum_last_day[0], target->last_date, sizeof(target->last_date));
+}
+
+//==============================================================
+// Move all series to the beginning of the pool
+// Replaced leaderboard entries leave unused bytes behind.
+void store_compact(series_store_t *target){
+  int order[n_series];
+  int n = 0;
+  for(int i=0; i<n_series; i++){
+    if(target->series[i].bytes > 0)
+      order[n++] = i;
+  }
+  std::sort(order, order+n, [target](int a, int b){
+    return target->series[a].offset < target->series[b].offset;
+  });
+  uint32_t pos = 0;
+  for(int i=0; i<n; i++){
+    series_t *series = &target->series[order[i]];
+    memmove(target->pool+pos, target->pool+series->offset, series->bytes);
+    series->offset = pos;
+    pos += series->bytes;
+  }
+  target->pool_used = pos;
+}
+
+//==============================================================
+// Decode the days of a series
+// data_index: 0 = confirmed, 1 = deaths
+// values must hold SERIES_LENGTH values
+void load_series(const series_store_t *source, int index, int data_index, int *values){
+  const series_t *series = &source->series[index];
+  const uint8_t *pos = source->pool + series->offset;
+  if(data_index == 1)
+    pos += series->deaths_offset;
+  uint32_t previous = 0;
+  for(int i=0; i<series->count; i++){
+    uint32_t code = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+      byte = *pos++;
+      code |= (uint32_t)(byte & 0x7F) << shift;
+      shift += 7;
+    } while(byte & 0x80);
+    int32_t delta = (int32_t)(code >> 1) ^ -(int32_t)(code & 1);
+    previous += (uint32_t)delta;
+    values[i] = (int)previous;
+  }
+}
+
+//==============================================================
+// A new country section starts
+// The country name is the first quoted string of the line:
+// "  \"Germany\": [\n"
+void start_country(const char* line){
+  const char* start = strchr(line, '"');
+  int length = 0;
+  if(start != NULL){
+    start++;
+    while(start[length] != '"' && start[length] != 0 && length < LEADERBOARD_NAME_LENGTH-1)
+      length++;
+    memcpy(current_country, start, length);
+  }
+  // pomber marks some country names with a '*'
+  if(length > 0 && current_country[length-1] == '*')
+    length--;
+  current_country[length] = 0;
+  current_first_day = -1;
+  current_day = -1;
+  current_skip = true;
+  in_country = true;
+}
+
+//==============================================================
+// Position of an epoch day inside the ring buffers
+int ring_pos(int day){
+  return (unsigned)(day - ring_base) % SERIES_LENGTH;
+}
+
+//==============================================================
+// The values of a new day of the current country follow
+// The current day is complete. Missing days are filled with the
+// values of the day before (the values are cumulative).
+// A date that is not after the current day is ignored.
+void set_day(int day){
+  if(!in_country)
+    return;
+  if(day <= current_day){
+    current_skip = true;
+    return;
+  }
+  current_skip = false;
+  int previous[2] = {0, 0};
+  if(current_day < 0){
+    current_first_day = day;
+    current_day = day-1;
+  } else {
+    finish_day(current_day);
+    previous[0] = current_data[0][ring_pos(current_day)];
+    previous[1] = current_data[1][ring_pos(current_day)];
+  }
+  // only the last SERIES_LENGTH days of a gap fit into the ring buffer
+  for(int d = std::max(current_day+1, day-SERIES_LENGTH+1); d <= day; d++){
+    current_data[0][ring_pos(d)] = previous[0];
+    current_data[1][ring_pos(d)] = previous[1];
+    if(d < day)
+      finish_day(d);
+  }
+  current_day = day;
+}
+
+//==============================================================
+// Add a complete day of the current country to the sums
+void finish_day(int day){
+  for(int n=0; n<(part_of_europe ? 2 : 1); n++){
+    for(int m=0; m<2; m++)
+      sum_add(n, m, day, current_data[m][ring_pos(day)]);
+  }
+}
+
+//==============================================================
+// Add a value to the day of a sum
+// n: 0 = "All countries", 1 = "Europe"
+// The sums keep the last SERIES_LENGTH days up to the latest day
+// found so far. Older days are dropped.
+void sum_add(int n, int data_index, int day, int value){
+  if(day > sum_last_day[n]){
+    // the days up to the new latest day start with the
+    // countries that already ended
+    for(int d = std::max(sum_last_day[n]+1, day-SERIES_LENGTH+1); d <= day; d++){
+      sum_data[n][0][ring_pos(d)] = sum_tail[n][0];
+      sum_data[n][1][ring_pos(d)] = sum_tail[n][1];
+    }
+    sum_last_day[n] = day;
+  } else if(day <= sum_last_day[n] - SERIES_LENGTH){
+    return;
+  }
+  if(sum_first_day[n] < 0 || day < sum_first_day[n])
+    sum_first_day[n] = day;
+  int *sum = &sum_data[n][data_index][ring_pos(day)];
+  *sum = sum_saturate((int64_t)*sum + value);
+}
+
+//==============================================================
+// A country of a sum ends at the given day
+// The values are cumulative, so its last value also counts for
+// the later days: the days up to the latest day found so far and
+// the days that are added later on.
+void sum_end(int n, int data_index, int day, int value){
+  for(int d = std::max(day+1, sum_last_day[n]-SERIES_LENGTH+1); d <= sum_last_day[n]; d++){
+    int *sum = &sum_data[n][data_index][ring_pos(d)];
+    *sum = sum_saturate((int64_t)*sum + value);
+  }
+  sum_tail[n][data_index] = sum_saturate((int64_t)sum_tail[n][data_index] + value);
+}
+
+//==============================================================
+// The sums are added up in 64 bit and cut to the range of an int
+int sum_saturate(int64_t value){
+  return (int)std::max<int64_t>(std::min<int64_t>(value, INT32_MAX), INT32_MIN);
+}
+
+//==============================================================
+// Reset the sums before a new file is parsed
+void sums_clear(){
+  for(int n=0; n<2; n++){
+    sum_first_day[n] = -1;
+    sum_last_day[n] = -1;
+    sum_tail[n][0] = 0;
+    sum_tail[n][1] = 0;
+  }
+}
+
+//==============================================================
+// Store a value of the current day of the current country
+// data_index: 0 = confirmed, 1 = deaths
+void add_value(int data_index, int value){
+  if(!in_country || current_skip)
+    return;
+  current_data[data_index][ring_pos(current_day)] = value;
+}
+
+//==============================================================
+// The current country section ends
+// index > 0: the country is part of the country list
+void end_country(int index){
+  in_country = false;
+  if(current_day < 0)
+    return;
+  // add the last day to all countries and the countries of europe
+  // and keep its values for the later days of the sums
+  finish_day(current_day);
+  for(int n=0; n<(part_of_europe ? 2 : 1); n++){
+    for(int m=0; m<2; m++)
+      sum_end(n, m, current_day, current_data[m][ring_pos(current_day)]);
+  }
+  if(index > 0)
+    store_current(parse_store, index);
+  leaderboard_end_country();
+}
+
+//==============================================================
+// Add the current country to the leaderboard of each metric
+void leaderboard_end_country(){
+  int confirmed = current_data[0][ring_pos(current_day)];
+  // new confirmed cases in the last 7 days
+  int growth = confirmed;
+  if(current_day - 7 >= current_first_day)
+    growth = confirmed - current_data[0][ring_pos(current_day - 7)];
+  leaderboard_insert(0, confirmed);
+  leaderboard_insert(1, current_data[1][ring_pos(current_day)]);
+  leaderboard_insert(2, growth);
+}
+
+//==============================================================
+// Insert the current country into the min-heap of a metric
+// The root of the heap is the smallest value of the leaderboard.
+// If the heap is full, the root is replaced and its series
+// inside the store is reused.
+// returns the index of the series or -1 if the value is too small
+int leaderboard_insert(int metric, int value){
+  leaderboard_entry_t *heap = parse_store->leaderboard[metric];
+  int n = parse_store->leaderboard_count[metric];
+  int i;
+  if(n < LEADERBOARD_SIZE){
+    i = n;
+    heap[i].series = n_countries + metric*LEADERBOARD_SIZE + n;
+    parse_store->leaderboard_count[metric]++;
+  } else {
+    if(value <= heap[0].value)
+      return -1;
+    i = 0;
+  }
+  heap[i].value = value;
+  // store the data of the current country
+  int series = heap[i].series;
+  store_current(parse_store, series);
+  strcpy(parse_store->leaderboard_names[series-n_countries], current_country);
+  if(n < LEADERBOARD_SIZE){
+    // sift up the new entry
+    while(i > 0 && heap[(i-1)/2].value > heap[i].value){
+      leaderboard_entry_t temp = heap[i];
+      heap[i] = heap[(i-1)/2];
+      heap[(i-1)/2] = temp;
+      i = (i-1)/2;
+    }
+  } else {
+    leaderboard_sift_down(heap, n, 0);
+  }
+  return series;
+}
+
+//==============================================================
+// Restore the min-heap property below entry i
+void leaderboard_sift_down(leaderboard_entry_t *heap, int n, int i){
+  while(true){
+    int smallest = i;
+    int left = 2*i+1;
+    int right = 2*i+2;
+    if(left < n && heap[left].value < heap[smallest].value)
+      smallest = left;
+    if(right < n && heap[right].value < heap[smallest].value)
+      smallest = right;
+    if(smallest == i)
+      return;
+    leaderboard_entry_t temp = heap[i];
+    heap[i] = heap[smallest];
+    heap[smallest] = temp;
+    i = smallest;
+  }
+}
+
+//==============================================================
+// Sort the leaderboard of each metric from the highest to the lowest value
+// and move the series inside the store to the index of the rank
+void leaderboard_sort(){
+  for(int m=0; m<n_leaderboard_metrics; m++){
+    leaderboard_entry_t *heap = parse_store->leaderboard[m];
+    int n = parse_store->leaderboard_count[m];
+    // heap sort: move the smallest value to the end
+    for(int last=n-1; last>0; last--){
+      leaderboard_entry_t temp = heap[0];
+      heap[0] = heap[last];
+      heap[last] = temp;
+      leaderboard_sift_down(heap, last, 0);
+    }
+    for(int r=0; r<n; r++){
+      int target = n_countries + m*LEADERBOARD_SIZE + r;
+      if(heap[r].series == target)
+        continue;
+      // the entry that uses the target storage gets the old storage
+      for(int k=r+1; k<n; k++){
+        if(heap[k].series == target){
+          heap[k].series = heap[r].series;
+          break;
+        }
+      }
+      swap_series(heap[r].series, target);
+      heap[r].series = target;
+    }
+  }
+}
+
+//==============================================================
+// Swap two leaderboard entries inside the parse store
+// Only the position inside the pool is swapped, not the data.
+void swap_series(int a, int b){
+  std::swap(parse_store->series[a], parse_store->series[b]);
+  char name[LEADERBOARD_NAME_LENGTH];
+  strcpy(name, parse_store->leaderboard_names[a-n_countries]);
+  strcpy(parse_store->leaderboard_names[a-n_countries], parse_store->leaderboard_names[b-n_countries]);
+  strcpy(parse_store->leaderboard_names[b-n_countries], name);
+}
+
+//==============================================================
+// Name of a country or a leaderboard entry of the live store
+const char* series_name(int index){
+  return series_name_in(store, index);
+}
+
+//==============================================================
+// Name of a series of any store
+const char* series_name_in(const series_store_t *source, int index){
+  if(index < n_countries)
+    return country_names[index];
+  return source->leaderboard_names[index-n_countries];
+}
+
+//==============================================================
+// Last value of a country or 0 if no data was found
+// data_index: 0 = confirmed, 1 = deaths
+int latest_value(int data_index, int index){
+  return store->series[index].latest[data_index];
+}
+
+//==============================================================
+// show the graphical or text view of a display_state
+void display_data(int state){
+  if(state < 3)
+    display_data_graph(state);
+  else if(state < 5)
+    display_data_graph_shifted(state);
+  else if(state < 11)
+    display_data_text(state);
+  else
+    display_data_leaderboard(state);
+}
+
+//==============================================================
+// Decode the days of the 5 selected countries
+// Nothing to do if the view already holds the same data.
+// data_index: 0 = confirmed, 1 = deaths
+void load_view(int data_index){
+  bool valid = (view_data_index == data_index);
+  for(int n=1; n<6; n++){
+    if(view_series[n] != country_selection[n])
+      valid = false;
+  }
+  if(valid)
+    return;
+  view_data_index = data_index;
+  for(int n=1; n<6; n++){
+    view_series[n] = country_selection[n];
+    load_series(store, view_series[n], data_index, view_data[n]);
+  }
+}
+
+//==============================================================
+// Minimum and maximum of the days first..last (inclusive)
+// of the selected country n
+void view_range(int n, int first, int last, int &y_min, int &y_max){
+  const int *data = view_data[n];
+  y_min = data[first];
+  y_max = data[first];
+  for(int i=first+1; i<=last; i++){
+    y_min = std::min(y_min, data[i]);
+    y_max = std::max(y_max, data[i]);
+  }
+}
+
+//==============================================================
+// Draw the days first..first+window-1 of the selected country n
+// over the full screen width
+void draw_series_window(int n, int first, int window, int max_y, uint32_t color){
+  const int *data = view_data[n];
+  int count = store->series[view_series[n]].count;
+  if(window < 2 || count == 0)
+    return;
+  graph_renderer graph;
+  graph.scale(window, max_y);
+  graph.series_lines(data, first, std::max(first+1, 1), std::min(first+window, count), color);
+}
+
+//==============================================================
+// First and last epoch day of the 5 selected countries
+// last_day < first_day if there are no days
+void zoom_range(int &first_day, int &last_day){
+  first_day = 0xFFFF;
+  last_day = -1;
+  for(int n=1; n<6; n++){
+    const series_t *series = &store->series[country_selection[n]];
+    if(series->count == 0)
+      continue;
+    first_day = std::min(first_day, (int)series->first_day);
+    last_day = std::max(last_day, series->first_day + series->count - 1);
+  }
+}
+
+//==============================================================
+// Number of calendar days of the 5 selected countries
+int zoom_history(){
+  int first_day, last_day;
+  zoom_range(first_day, last_day);
+  return std::max(last_day - first_day + 1, 0);
+}
+
+//==============================================================
+// Number of visible days with the current zoom level
+int zoom_days(){
+  return zoom_history() >> zoom_level;
+}
+
+//==============================================================
+// Move the visible days by the given number of days into the past
+// (negative values move towards the latest day)
+void zoom_pan(int days){
+  zoom_offset += days;
+  if(zoom_offset > zoom_history() - zoom_days())
+    zoom_offset = zoom_history() - zoom_days();
+  if(zoom_offset < 0)
+    zoom_offset = 0;
+}
+
+//==============================================================
+// display the data as curves / graphs including a legend
+void display_data_graph(int data_select){
+  M5.Lcd.fillScreen(BLACK);
+  invalidate_list();
+  load_view(data_select-1);
+  int selected_country;
+  // visible days of each country
+  // all countries are aligned by their dates, without zoom
+  // the graph shows all days of the selected countries
+  int history_first, history_last;
+  zoom_range(history_first, history_last);
+  int view_first = history_last - zoom_offset - zoom_days() + 1;
+  int first[6];
+  int window[6];
+  for(int n=1; n<6; n++){
+    selected_country = country_selection[n];
+    window[n] = zoom_days();
+    first[n] = view_first - store->series[selected_country].first_day;
+  }
+  // get maximum value of the visible days to scale the y-axis
+  int max_y = 0;
+  for(int n=1; n<6; n++){
+    int y_min, y_max;
+    int last = std::min(first[n]+window[n], (int)store->series[country_selection[n]].count) - 1;
+    if(std::max(first[n], 0) <= last){
+      view_range(n, std::max(first[n], 0), last, y_min, y_max);
+      if(y_max > max_y)
+        max_y = y_max;
+    }
+  }
+  // draw weekly grid lines
+  graph_renderer graph;
+  graph.scale(window[1], max_y);
+  graph.grid_weeks(view_first, window[1]);
+  // draw line graph
+  for(int n=1; n<6; n++)
+    draw_series_window(n, first[n], window[n], max_y, country_color[n]);
+  // draw legend
+  graph.legend_begin();
   // headline
-  M5.Lcd.printf("\n%s (%s)\n\n", data_name[data_select-1], last_date.c_str());
-  // Country name and value
+  char detail[32];
+  if(menu_state == 5)
+    snprintf(detail, sizeof(detail), "x%i, -%i days", 1 << zoom_level, zoom_offset);
+  else
+    snprintf(detail, sizeof(detail), "%s", store->last_date);
+  graph.legend_headline(data_name[data_select-1], detail);
+  // Country name and value of the last visible day
   for(int n=1; n<6; n++){
     selected_country = country_selection[n];
-    M5.Lcd.setTextColor(country_color[n]);
-    M5.Lcd.printf("%s:\n%s\n", country_names[selected_country].c_str(), 
-                               formatNumber(collected_data[data_select-1][selected_country][data_count[selected_country]-1], 
-                                            format_buffer, 
-                                            sizeof(format_buffer)));
+    int last = std::min(first[n]+window[n], (int)store->series[selected_country].count) - 1;
+    graph.legend_entry(country_color[n], series_name(selected_country), 
+                       formatNumber(last >= 0 ? view_data[n][last] : 0, 
+                                    format_buffer, 
+                                    sizeof(format_buffer)));
   }
-  M5.Lcd.setTextColor(WHITE);
+  graph.legend_end();
+  // the zoom mode keeps its buttons on the screen
+  if(menu_state == 5)
+    print_menu(menu_state);
   // Filename for Screen-dump to SD Card
   snprintf(Filename, sizeof(Filename), "/graph_%i.ppm",data_select);
 }
@@ -888,27 +3649,24 @@ void display_data_graph(int data_select){
 // display the data as curves shifted in x so that all countries
 // aligned with the first increase of data
 void display_data_graph_shifted(int data_select){
-  print_menu(4);
-  delay(200);
   M5.Lcd.fillScreen(BLACK);
+  invalidate_list();
+  load_view(data_select-3);
   int selected_country;
   // get maximum value to scale the y-axis
   int max_y = 0;
   for(int n=1; n<6; n++){
     selected_country = country_selection[n];
-    for(int i = 0; i < data_count[selected_country]; i++){
-      if(collected_data[data_select-3][selected_country][i] > max_y)
-        max_y = collected_data[data_select-3][selected_country][i];
+    for(int i = 0; i < store->series[selected_country].count; i++){
+      if(view_data[n][i] > max_y)
+        max_y = view_data[n][i];
     }
   }
   // draw weekly grid lines
   // start from the left and go forward
-  int xpos = 0;
-  float x_scale = float(SCREEN_WIDTH) / data_count[1];
-  while(xpos < data_count[country_selection[1]]){
-    M5.Lcd.drawLine(trunc(x_scale*xpos), 0, trunc(x_scale*xpos), (SCREEN_HEIGHT-1), 0x528A);
-    xpos = xpos +7;
-  }
+  graph_renderer graph;
+  graph.scale(store->series[country_selection[1]].count, max_y);
+  graph.grid_from_start(store->series[country_selection[1]].count);
   // find the x position of first grow of data for each country
   // threshold is a value above 4000 (confirmed) and 500 (deaths)
   int y_threshold = 4000;
@@ -919,8 +3677,8 @@ void display_data_graph_shifted(int data_select){
   for(int n=1; n<6; n++){
     selected_country = country_selection[n];
     first_y[n] = 0;
-    for(int i = 0; i < data_count[selected_country]; i++){
-      if(collected_data[data_select-3][selected_country][i] < y_threshold){
+    for(int i = 0; i < store->series[selected_country].count; i++){
+      if(view_data[n][i] < y_threshold){
         first_y[n] = i-14; // go back 2 Weeks
         // find the largest position
         if(i > first_y_max)
@@ -931,29 +3689,20 @@ void display_data_graph_shifted(int data_select){
   // draw the shifted line graph
   for(int n=1; n<6; n++){
     selected_country = country_selection[n];
-    x_scale = float(SCREEN_WIDTH) / data_count[selected_country];
-    for(int i = first_y[n]; i < data_count[selected_country]; i++){
-      if(i > 0){
-        M5.Lcd.drawLine(trunc(x_scale*((i-first_y[n])-1)), 
-                        (SCREEN_HEIGHT-1)-(round((float((SCREEN_HEIGHT-1)) / max_y) * collected_data[data_select-3][selected_country][i-1])), 
-                        trunc(x_scale*(i-first_y[n])), 
-                        (SCREEN_HEIGHT-1)-(round((float((SCREEN_HEIGHT-1)) / max_y) * collected_data[data_select-3][selected_country][i])), 
-                        country_color[n]);
-      }
-    }
+    graph.scale(store->series[selected_country].count, max_y);
+    graph.series_lines(view_data[n], first_y[n], std::max(first_y[n]+1, 1), 
+                       store->series[selected_country].count, country_color[n]);
   }
   // draw legend
-  M5.Lcd.setFreeFont(FF1);
-  M5.Lcd.setCursor(0, 0);
+  graph.legend_begin();
   // headline
-  M5.Lcd.printf("\n%s (shifted)\n\n", data_name[data_select-3]);
+  graph.legend_headline(data_name[data_select-3], "shifted");
   // Country name
   for(int n=1; n<6; n++){
     selected_country = country_selection[n];
-    M5.Lcd.setTextColor(country_color[n]);
-    M5.Lcd.printf("%s\n", country_names[selected_country].c_str());
+    graph.legend_entry(country_color[n], series_name(selected_country), NULL);
   }
-  M5.Lcd.setTextColor(WHITE);
+  graph.legend_end();
   // Filename for Screen-dump to SD Card
   snprintf(Filename, sizeof(Filename), "/graph_shifted_%i.ppm",data_select);
 }
@@ -968,11 +3717,11 @@ void display_data_text(int data_select){
   M5.Lcd.setFreeFont(FF2);
   M5.Lcd.setCursor(0, 0);
   M5.Lcd.setTextColor(country_color[data_select-5]);
-  M5.Lcd.printf("\n%s:\n\n", country_names[selected_country].c_str());
+  M5.Lcd.printf("\n%s:\n\n", series_name(selected_country));
   M5.Lcd.setFreeFont(FF1);
   M5.Lcd.setTextColor(WHITE);
-  int n_confirmed = collected_data[0][selected_country][data_count[selected_country]-1];
-  int n_deaths = collected_data[1][selected_country][data_count[selected_country]-1];
+  int n_confirmed = latest_value(0, selected_country);
+  int n_deaths = latest_value(1, selected_country);
   M5.Lcd.printf("  confirmed:  %s\n", formatNumber(n_confirmed, format_buffer, sizeof(format_buffer)));
   M5.Lcd.printf("  deaths:     %s\n\n",    formatNumber(n_deaths, format_buffer, sizeof(format_buffer)));
   M5.Lcd.printf("  death rate:    %6.2f%%\n", (100.0/n_confirmed) * n_deaths);
@@ -980,6 +3729,28 @@ void display_data_text(int data_select){
   snprintf(Filename, sizeof(Filename), "/text_%i.ppm",data_select);
 }
 
+//==============================================================
+// display the leaderboard of one metric as text output
+void display_data_leaderboard(int data_select){
+  int metric = data_select-11;
+  Clear_Screen();
+  print_menu(4);
+  M5.Lcd.setFreeFont(FF1);
+  M5.Lcd.setCursor(0, 0);
+  M5.Lcd.setTextColor(WHITE);
+  // headline
+  M5.Lcd.printf("\n%s (%s)\n\n", leaderboard_title[metric], store->last_date);
+  // rank, country name and value
+  for(int r=0; r<store->leaderboard_count[metric]; r++){
+    M5.Lcd.setTextColor(country_color[r+1]);
+    M5.Lcd.printf("%i %-16.16s%s\n", r+1, series_name(n_countries + metric*LEADERBOARD_SIZE + r), 
+                  formatNumber(store->leaderboard[metric][r].value, format_buffer, sizeof(format_buffer)));
+  }
+  M5.Lcd.setTextColor(WHITE);
+  // Filename for Screen-dump to SD Card
+  snprintf(Filename, sizeof(Filename), "/top_%i.ppm",data_select);
+}
+
 //==============================================================
 // Dump the screen to a File
 // Image file format: .ppm
@@ -1011,3 +3782,254 @@ bool M5Screen2File(fs::FS &fs, const char * path){
   } else
     return false;
 }
+
+#if defined(PROGRESS_BENCHMARK)
+//==============================================================
+// Synthetic data files in the format of pomber's timeseries.json
+// or of the JHU CSV time series
+// The file is generated while it is read, so even the 20x file
+// needs no memory. The first countries are the configured ones.
+// In the CSV files, the first country is split into two provinces.
+// Optional: the stream ends after truncate_at bytes and every
+// 1 out of mutate_rate bytes is replaced by a random character.
+enum {SYNTHETIC_PRETTY, SYNTHETIC_MINIFIED, SYNTHETIC_CSV_CONFIRMED, SYNTHETIC_CSV_DEATHS};
+class synthetic_feed_t : public Stream {
+ public:
+  synthetic_feed_t(int countries, int days, int format, uint32_t seed = 1,
+                   unsigned long truncate_at = 0, int mutate_rate = 0) :
+    countries(countries), days(days), format(format), random_state(seed),
+    truncate_at(truncate_at), mutate_rate(mutate_rate) {
+    // the CSV files start with the header row
+    if(format >= SYNTHETIC_CSV_CONFIRMED)
+      country = -1;
+  }
+  int available(){
+    fill();
+    return chunk_length - chunk_pos;
+  }
+  int read(){
+    if(available() == 0)
+      return -1;
+    bytes_read++;
+    return (uint8_t)chunk[chunk_pos++];
+  }
+  int peek(){
+    if(available() == 0)
+      return -1;
+    return (uint8_t)chunk[chunk_pos];
+  }
+  size_t write(uint8_t){ return 0; }
+  void flush(){}
+  unsigned long bytes_read = 0;
+
+ private:
+  int countries;
+  int days;
+  int format;
+  uint32_t random_state;
+  unsigned long truncate_at;
+  int mutate_rate;
+  // JSON: index of the country, CSV: index of the row (-1 = header)
+  int country = 0;
+  // -1 = country name, days = end of the country section
+  int day = -1;
+  bool done = false;
+  char chunk[192];
+  int chunk_length = 0;
+  int chunk_pos = 0;
+
+  uint32_t next_random(){
+    // xorshift32
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+  }
+  void fill(){
+    if(chunk_pos < chunk_length)
+      return;
+    chunk_pos = 0;
+    chunk_length = 0;
+    if(done || (truncate_at > 0 && bytes_read >= truncate_at))
+      return;
+    if(format >= SYNTHETIC_CSV_CONFIRMED)
+      fill_csv();
+    else
+      fill_json();
+    if(mutate_rate > 0){
+      const char fuzz_chars[] = "\"[]{},:\\ \n0123456789-/.";
+      for(int i=0; i<chunk_length; i++){
+        if(next_random() % mutate_rate == 0)
+          chunk[i] = fuzz_chars[next_random() % (sizeof(fuzz_chars)-1)];
+      }
+    }
+  }
+  void fill_json(){
+    bool minified = (format == SYNTHETIC_MINIFIED);
+    if(country == countries){
+      chunk_length = snprintf(chunk, sizeof(chunk), minified ? "}" : "}\n");
+      done = true;
+    } else if(day < 0){
+      char name[LEADERBOARD_NAME_LENGTH];
+      synthetic_name(country, name, sizeof(name));
+      chunk_length = snprintf(chunk, sizeof(chunk), minified ? "%s\"%s\":[" : "%s  \"%s\": [\n", 
+                              country == 0 ? (minified ? "{" : "{\n") : "", name);
+      day = 0;
+    } else if(day < days){
+      char date[16];
+      int year, month, day_of_month;
+      synthetic_date(day, year, month, day_of_month);
+      snprintf(date, sizeof(date), "%i-%i-%i", year, month, day_of_month);
+      int confirmed = synthetic_value(country, day);
+      const char *separator = (day < days-1) ? "," : "";
+      if(minified)
+        chunk_length = snprintf(chunk, sizeof(chunk), 
+                                "{\"date\":\"%s\",\"confirmed\":%i,\"deaths\":%i,\"recovered\":%i}%s",
+                                date, confirmed, confirmed/50, confirmed/2, separator);
+      else
+        chunk_length = snprintf(chunk, sizeof(chunk), 
+                                "    {\n      \"date\": \"%s\",\n      \"confirmed\": %i,\n"
+                                "      \"deaths\": %i,\n      \"recovered\": %i\n    }%s\n",
+                                date, confirmed, confirmed/50, confirmed/2, separator);
+      day++;
+    } else {
+      const char *separator = (country < countries-1) ? "," : "";
+      chunk_length = snprintf(chunk, sizeof(chunk), minified ? "]%s" : "  ]%s\n", separator);
+      country++;
+      day = -1;
+    }
+  }
+  void fill_csv(){
+    // row 0 and 1 are the provinces of the first country
+    int row_country = country < 2 ? 0 : country-1;
+    if(row_country == countries){
+      done = true;
+    } else if(day < 0){
+      if(country < 0){
+        chunk_length = snprintf(chunk, sizeof(chunk), "Province/State,Country/Region,Lat,Long");
+      } else {
+        char name[LEADERBOARD_NAME_LENGTH];
+        synthetic_name(row_country, name, sizeof(name));
+        const char *quote = strchr(name, ',') ? "\"" : "";
+        chunk_length = snprintf(chunk, sizeof(chunk), "%s,%s%s%s,0.0,0.0", 
+                                country < 2 ? (country == 0 ? "North" : "South") : "",
+                                quote, name, quote);
+      }
+      day = 0;
+    } else if(day < days){
+      if(country < 0){
+        int year, month, day_of_month;
+        synthetic_date(day, year, month, day_of_month);
+        chunk_length = snprintf(chunk, sizeof(chunk), ",%i/%i/%i", month, day_of_month, year % 100);
+      } else {
+        int value = synthetic_value(row_country, day);
+        if(format == SYNTHETIC_CSV_DEATHS)
+          value = value/50;
+        // the first province gets the first half
+        if(country == 0)
+          value = value/2;
+        else if(country == 1)
+          value = value - value/2;
+        chunk_length = snprintf(chunk, sizeof(chunk), ",%i", value);
+      }
+      day++;
+    } else {
+      chunk_length = snprintf(chunk, sizeof(chunk), "\n");
+      country++;
+      day = -1;
+    }
+  }
+};
+
+//==============================================================
+// Name of a country of the synthetic data files
+void synthetic_name(int country, char *buffer, int len){
+  if(country < n_countries-2)
+    snprintf(buffer, len, "%s", country_names[country+2]);
+  else
+    snprintf(buffer, len, "Country %i", country);
+}
+
+//==============================================================
+// Date of a day of the synthetic data files
+// The first day is the first day of pomber's file: 2020-1-22
+void synthetic_date(int day, int &year, int &month, int &day_of_month){
+  const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  year = 2020;
+  month = 0;
+  day += 21;
+  while(true){
+    int length = month_days[month] + ((month == 1 && year % 4 == 0) ? 1 : 0);
+    if(day < length)
+      break;
+    day -= length;
+    if(++month == 12){
+      month = 0;
+      year++;
+    }
+  }
+  month++;
+  day_of_month = day+1;
+}
+
+//==============================================================
+// confirmed value of a country and day of the synthetic data files
+// the deaths are 1/50 of the confirmed value
+int synthetic_value(int country, int day){
+  return (country+1)*(day*day/8) + day;
+}
+#endif
+
+#if defined(PROGRESS_BENCHMARK)
+//==============================================================
+// Progress screen of version 1.09 as reference
+// The screen was cleared and the percentage of 200 countries was
+// drawn with a large free font at the start of every country.
+void legacy_progress(int countries_found){
+  Clear_Screen();
+  M5.Lcd.setTextDatum(CC_DATUM);
+  M5.Lcd.setFreeFont(FF3);
+  char text_buffer[32];
+  snprintf(text_buffer, sizeof(text_buffer), "%3.0f%%",
+          std::min(100.0, (100.0/200)*countries_found));
+  M5.Lcd.drawString(text_buffer, (int)(M5.Lcd.width()/2), (int)(M5.Lcd.height()/2), 1);
+}
+
+//==============================================================
+// Cost of the progress display while the 1x JSON file is parsed
+// v1.09: one redraw per country inside the parse loop
+// now: the progress task draws the bar on the other core
+void progress_benchmark(){
+  unsigned long timeout_ms = parse_timeout_ms;
+  // the synthetic stream never has to wait for data
+  parse_timeout_ms = 0;
+  synthetic_feed_t feed(SYNTHETIC_COUNTRIES, SYNTHETIC_DAYS, SYNTHETIC_PRETTY);
+  process_data(feed, store);
+  unsigned long parse_us = parse_stats.total_us;
+  unsigned long file_bytes = parse_stats.bytes;
+  // the redraws of v1.09 for the same number of countries
+  unsigned long start = micros();
+  for(int n=1; n<=SYNTHETIC_COUNTRIES; n++)
+    legacy_progress(n);
+  unsigned long legacy_us = micros() - start;
+  // the same file with the bar of the progress task
+  synthetic_feed_t progress_feed(SYNTHETIC_COUNTRIES, SYNTHETIC_DAYS, SYNTHETIC_PRETTY);
+  stream_length = file_bytes;
+  progress_begin("Progress benchmark");
+  process_data(progress_feed, store);
+  progress_end();
+  stream_length = 0;
+  parse_timeout_ms = timeout_ms;
+  unsigned long progress_us = parse_stats.total_us;
+  Serial.printf("[PROGRESS] parse %lu ms, v1.09 redraws %lu ms (%lu us per country, +%lu%%)\n",
+                parse_us/1000, legacy_us/1000, legacy_us/SYNTHETIC_COUNTRIES,
+                (unsigned long)((uint64_t)legacy_us*100/std::max(parse_us, 1UL)));
+  Serial.printf("[PROGRESS] parse with the progress task %lu ms (%+li ms)\n",
+                progress_us/1000, ((long)progress_us - (long)parse_us)/1000);
+  Clear_Screen();
+  M5.Lcd.setFreeFont(FF1);
+  M5.Lcd.setTextColor(WHITE);
+  M5.Lcd.printf("parse %lu ms\nv1.09 redraws +%lu ms\nprogress task %+li ms\n", parse_us/1000,
+                legacy_us/1000, ((long)progress_us - (long)parse_us)/1000);
+}
+#endif
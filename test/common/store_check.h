@@ -0,0 +1,148 @@
+/**************************************************************************
+ * Checks of a series store for the host tests
+ *
+ * Include behind main.cpp and synthetic_feed.h.
+**************************************************************************/
+#pragma once
+
+//==============================================================
+// Check that a store is consistent after parsing any input
+// returns the number of errors
+int check_store(const series_store_t *source){
+  int errors = 0;
+  if(source->pool_used > STORE_POOL_SIZE)
+    errors++;
+  for(int i=0; i<n_series; i++){
+    const series_t *series = &source->series[i];
+    if(series->count > SERIES_LENGTH || series->deaths_offset > series->bytes ||
+       (series->bytes > 0 && series->offset + series->bytes > source->pool_used))
+      errors++;
+  }
+  for(int m=0; m<n_leaderboard_metrics; m++){
+    if(source->leaderboard_count[m] < 0 || source->leaderboard_count[m] > LEADERBOARD_SIZE)
+      errors++;
+  }
+  for(int n=0; n<n_leaderboard_metrics*LEADERBOARD_SIZE; n++){
+    if(strnlen(source->leaderboard_names[n], LEADERBOARD_NAME_LENGTH) >= LEADERBOARD_NAME_LENGTH)
+      errors++;
+  }
+  if(strnlen(source->last_date, sizeof(source->last_date)) >= sizeof(source->last_date))
+    errors++;
+  return errors;
+}
+
+//==============================================================
+// Epoch day of a day of the synthetic data files
+int synthetic_epoch_day(int day){
+  int year, month, day_of_month;
+  synthetic_date(day, year, month, day_of_month);
+  return epoch_day(year, month, day_of_month);
+}
+
+//==============================================================
+// true if a country of the synthetic data files is part of Europe
+bool synthetic_europe(int country){
+  char name[LEADERBOARD_NAME_LENGTH];
+  synthetic_name(country, name, sizeof(name));
+  for(int n=0; n<n_europe_countries; n++){
+    if(strcmp(name, europe_names[n]) == 0)
+      return true;
+  }
+  return false;
+}
+
+//==============================================================
+// Expected value of a series of the store for a synthetic file
+// series: -1 = "All countries", -2 = "Europe", else the country
+// The sums saturate like the store.
+int synthetic_expected(int countries, int series, int data_index, int day){
+  int64_t value = 0;
+  for(int country=0; country<countries; country++){
+    if(series >= 0 && country != series)
+      continue;
+    if(series == -2 && !synthetic_europe(country))
+      continue;
+    int confirmed = synthetic_value(country, day);
+    value += data_index == 0 ? confirmed : confirmed/50;
+  }
+  return (int)std::min(value, (int64_t)INT32_MAX);
+}
+
+//==============================================================
+// Compare one series of the store with the generator
+// The series must end at the last day of the file and hold the
+// last SERIES_LENGTH days (fewer if the pool was full).
+// returns the number of errors
+int check_series(const series_store_t *source, int index, int countries, int days, int series){
+  const series_t *stored = &source->series[index];
+  int count = std::min(days, SERIES_LENGTH);
+  if(stored->count > count || (!pool_overflow && stored->count != count)){
+    printf("series %i (%s): %i days instead of %i\n", index, series_name_in(source, index),
+           stored->count, count);
+    return 1;
+  }
+  if(stored->count == 0)
+    return 0;
+  int first = days - stored->count;
+  if(stored->first_day != synthetic_epoch_day(first)){
+    printf("series %i (%s): first day %i instead of %i\n", index, series_name_in(source, index),
+           stored->first_day, synthetic_epoch_day(first));
+    return 1;
+  }
+  int errors = 0;
+  static int values[SERIES_LENGTH];
+  for(int m=0; m<2; m++){
+    load_series(source, index, m, values);
+    for(int d=0; d<stored->count; d++){
+      int expected = synthetic_expected(countries, series, m, first + d);
+      if(values[d] != expected){
+        if(errors < 3)
+          printf("series %i (%s) %s day %i: %i instead of %i\n", index, series_name_in(source, index),
+                 data_name[m], first + d, values[d], expected);
+        errors++;
+      }
+    }
+    if(stored->latest[m] != synthetic_expected(countries, series, m, days-1))
+      errors++;
+  }
+  return errors;
+}
+
+//==============================================================
+// Compare every series of the store with the generator:
+// the sums, the configured countries and the leaderboard
+// Every metric of the synthetic files grows with the index of the
+// country, so the last countries of the file lead every metric.
+// returns the number of errors
+int check_generated(const series_store_t *source, int countries, int days){
+  int errors = 0;
+  if(!source->valid)
+    errors++;
+  errors += check_series(source, 0, countries, days, -1);
+  errors += check_series(source, 1, countries, days, -2);
+  for(int i=2; i<n_countries; i++){
+    if(i-2 < countries)
+      errors += check_series(source, i, countries, days, i-2);
+    else if(source->series[i].count != 0)
+      errors++;
+  }
+  for(int m=0; m<n_leaderboard_metrics; m++){
+    for(int r=0; r<LEADERBOARD_SIZE && r<countries; r++){
+      int country = countries-1-r;
+      int index = n_countries + m*LEADERBOARD_SIZE + r;
+      char name[LEADERBOARD_NAME_LENGTH];
+      synthetic_name(country, name, sizeof(name));
+      if(strcmp(source->leaderboard_names[index-n_countries], name) != 0){
+        printf("leaderboard %s #%i: %s instead of %s\n", leaderboard_tag[m], r+1,
+               source->leaderboard_names[index-n_countries], name);
+        errors++;
+      }
+      errors += check_series(source, index, countries, days, country);
+    }
+  }
+  char last_date[16];
+  format_date(synthetic_epoch_day(days-1), last_date, sizeof(last_date));
+  if(strcmp(source->last_date, last_date) != 0)
+    errors++;
+  return errors;
+}
@@ -0,0 +1,206 @@
+/**************************************************************************
+ * Synthetic data files for the host tests
+ *
+ * Include behind main.cpp (uses the country tables and
+ * LEADERBOARD_NAME_LENGTH).
+**************************************************************************/
+#pragma once
+
+void synthetic_name(int country, char *buffer, int len);
+void synthetic_date(int day, int &year, int &month, int &day_of_month);
+int synthetic_value(int country, int day);
+
+//==============================================================
+// Synthetic data files in the format of pomber's timeseries.json
+// or of the JHU CSV time series
+// The file is generated while it is read, so even the 20x file
+// needs no memory. The first countries are the configured ones.
+// In the CSV files, the first country is split into two provinces.
+// Optional: the stream ends after truncate_at bytes and every
+// 1 out of mutate_rate bytes is replaced by a random character.
+enum {SYNTHETIC_PRETTY, SYNTHETIC_MINIFIED, SYNTHETIC_CSV_CONFIRMED, SYNTHETIC_CSV_DEATHS};
+class synthetic_feed_t : public Stream {
+ public:
+  synthetic_feed_t(int countries, int days, int format, uint32_t seed = 1,
+                   unsigned long truncate_at = 0, int mutate_rate = 0) :
+    countries(countries), days(days), format(format), random_state(seed),
+    truncate_at(truncate_at), mutate_rate(mutate_rate) {
+    // the CSV files start with the header row
+    if(format >= SYNTHETIC_CSV_CONFIRMED)
+      country = -1;
+  }
+  int available(){
+    fill();
+    return chunk_length - chunk_pos;
+  }
+  int read(){
+    if(available() == 0)
+      return -1;
+    bytes_read++;
+    return (uint8_t)chunk[chunk_pos++];
+  }
+  int peek(){
+    if(available() == 0)
+      return -1;
+    return (uint8_t)chunk[chunk_pos];
+  }
+  size_t write(uint8_t){ return 0; }
+  void flush(){}
+  unsigned long bytes_read = 0;
+
+ private:
+  int countries;
+  int days;
+  int format;
+  uint32_t random_state;
+  unsigned long truncate_at;
+  int mutate_rate;
+  // JSON: index of the country, CSV: index of the row (-1 = header)
+  int country = 0;
+  // -1 = country name, days = end of the country section
+  int day = -1;
+  bool done = false;
+  char chunk[192];
+  int chunk_length = 0;
+  int chunk_pos = 0;
+
+  uint32_t next_random(){
+    // xorshift32
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+  }
+  void fill(){
+    if(chunk_pos < chunk_length)
+      return;
+    chunk_pos = 0;
+    chunk_length = 0;
+    if(done || (truncate_at > 0 && bytes_read >= truncate_at))
+      return;
+    if(format >= SYNTHETIC_CSV_CONFIRMED)
+      fill_csv();
+    else
+      fill_json();
+    if(mutate_rate > 0){
+      const char fuzz_chars[] = "\"[]{},:\\ \n0123456789-/.";
+      for(int i=0; i<chunk_length; i++){
+        if(next_random() % mutate_rate == 0)
+          chunk[i] = fuzz_chars[next_random() % (sizeof(fuzz_chars)-1)];
+      }
+    }
+  }
+  void fill_json(){
+    bool minified = (format == SYNTHETIC_MINIFIED);
+    if(country == countries){
+      chunk_length = snprintf(chunk, sizeof(chunk), minified ? "}" : "}\n");
+      done = true;
+    } else if(day < 0){
+      char name[LEADERBOARD_NAME_LENGTH];
+      synthetic_name(country, name, sizeof(name));
+      chunk_length = snprintf(chunk, sizeof(chunk), minified ? "%s\"%s\":[" : "%s  \"%s\": [\n", 
+                              country == 0 ? (minified ? "{" : "{\n") : "", name);
+      day = 0;
+    } else if(day < days){
+      char date[16];
+      int year, month, day_of_month;
+      synthetic_date(day, year, month, day_of_month);
+      snprintf(date, sizeof(date), "%i-%i-%i", year, month, day_of_month);
+      int confirmed = synthetic_value(country, day);
+      const char *separator = (day < days-1) ? "," : "";
+      if(minified)
+        chunk_length = snprintf(chunk, sizeof(chunk), 
+                                "{\"date\":\"%s\",\"confirmed\":%i,\"deaths\":%i,\"recovered\":%i}%s",
+                                date, confirmed, confirmed/50, confirmed/2, separator);
+      else
+        chunk_length = snprintf(chunk, sizeof(chunk), 
+                                "    {\n      \"date\": \"%s\",\n      \"confirmed\": %i,\n"
+                                "      \"deaths\": %i,\n      \"recovered\": %i\n    }%s\n",
+                                date, confirmed, confirmed/50, confirmed/2, separator);
+      day++;
+    } else {
+      const char *separator = (country < countries-1) ? "," : "";
+      chunk_length = snprintf(chunk, sizeof(chunk), minified ? "]%s" : "  ]%s\n", separator);
+      country++;
+      day = -1;
+    }
+  }
+  void fill_csv(){
+    // row 0 and 1 are the provinces of the first country
+    int row_country = country < 2 ? 0 : country-1;
+    if(row_country == countries){
+      done = true;
+    } else if(day < 0){
+      if(country < 0){
+        chunk_length = snprintf(chunk, sizeof(chunk), "Province/State,Country/Region,Lat,Long");
+      } else {
+        char name[LEADERBOARD_NAME_LENGTH];
+        synthetic_name(row_country, name, sizeof(name));
+        const char *quote = strchr(name, ',') ? "\"" : "";
+        chunk_length = snprintf(chunk, sizeof(chunk), "%s,%s%s%s,0.0,0.0", 
+                                country < 2 ? (country == 0 ? "North" : "South") : "",
+                                quote, name, quote);
+      }
+      day = 0;
+    } else if(day < days){
+      if(country < 0){
+        int year, month, day_of_month;
+        synthetic_date(day, year, month, day_of_month);
+        chunk_length = snprintf(chunk, sizeof(chunk), ",%i/%i/%i", month, day_of_month, year % 100);
+      } else {
+        int value = synthetic_value(row_country, day);
+        if(format == SYNTHETIC_CSV_DEATHS)
+          value = value/50;
+        // the first province gets the first half
+        if(country == 0)
+          value = value/2;
+        else if(country == 1)
+          value = value - value/2;
+        chunk_length = snprintf(chunk, sizeof(chunk), ",%i", value);
+      }
+      day++;
+    } else {
+      chunk_length = snprintf(chunk, sizeof(chunk), "\n");
+      country++;
+      day = -1;
+    }
+  }
+};
+
+//==============================================================
+// Name of a country of the synthetic data files
+void synthetic_name(int country, char *buffer, int len){
+  if(country < n_countries-2)
+    snprintf(buffer, len, "%s", country_names[country+2]);
+  else
+    snprintf(buffer, len, "Country %i", country);
+}
+
+//==============================================================
+// Date of a day of the synthetic data files
+// The first day is the first day of pomber's file: 2020-1-22
+void synthetic_date(int day, int &year, int &month, int &day_of_month){
+  const int month_days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  year = 2020;
+  month = 0;
+  day += 21;
+  while(true){
+    int length = month_days[month] + ((month == 1 && year % 4 == 0) ? 1 : 0);
+    if(day < length)
+      break;
+    day -= length;
+    if(++month == 12){
+      month = 0;
+      year++;
+    }
+  }
+  month++;
+  day_of_month = day+1;
+}
+
+//==============================================================
+// confirmed value of a country and day of the synthetic data files
+// the deaths are 1/50 of the confirmed value
+int synthetic_value(int country, int day){
+  return (country+1)*(day*day/8) + day;
+}
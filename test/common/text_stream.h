@@ -0,0 +1,24 @@
+/**************************************************************************
+ * Stream over a text in memory and Print into a text for the host tests
+**************************************************************************/
+#pragma once
+
+class text_stream_t : public Stream {
+ public:
+  text_stream_t(const char *text) : text(text) {}
+  int available(){ return strlen(text); }
+  int read(){ return *text ? (uint8_t)*text++ : -1; }
+  int peek(){ return *text ? (uint8_t)*text : -1; }
+  size_t write(uint8_t){ return 0; }
+ private:
+  const char *text;
+};
+
+class text_print_t : public Print {
+ public:
+  size_t write(uint8_t c){
+    text += (char)c;
+    return 1;
+  }
+  std::string text;
+};
@@ -0,0 +1,173 @@
+/**************************************************************************
+ * Host mock of the Arduino core for the native test environment
+ *
+ * Only the part of the API that main.cpp uses is implemented.
+ * The mocks are header only: every test is a single translation unit
+ * that includes main.cpp, so the objects and functions are defined
+ * here and the headers must not be included in a second file.
+**************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <thread>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define DEC 10
+#define HEX 16
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define INPUT_PULLUP 0x05
+#define LOW 0x0
+#define HIGH 0x1
+#define IRAM_ATTR
+
+//==============================================================
+// String, only what is needed to pass text around
+class String {
+ public:
+  String(const char *text = "") : text(text) {}
+  String(const std::string &text) : text(text) {}
+  const char *c_str() const { return text.c_str(); }
+  unsigned int length() const { return text.size(); }
+  bool operator==(const char *other) const { return text == other; }
+ private:
+  std::string text;
+};
+
+class Print;
+class Printable {
+ public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+//==============================================================
+// Print and Stream with the formatting of the Arduino core
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size){
+    size_t n = 0;
+    while(size--)
+      n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char *text){ return write((const uint8_t*)text, strlen(text)); }
+  size_t printf(const char *format, ...){
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if(length < 0)
+      return 0;
+    return write((const uint8_t*)buffer, std::min((size_t)length, sizeof(buffer)-1));
+  }
+  size_t print(const char *text){ return write(text); }
+  size_t print(const String &text){ return write(text.c_str()); }
+  size_t print(char c){ return write((uint8_t)c); }
+  size_t print(int value, int base = DEC){ return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC){ return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC){ return base == DEC ? printf("%ld", value) : print((unsigned long)value, base); }
+  size_t print(unsigned long value, int base = DEC){ return printf(base == HEX ? "%lX" : "%lu", value); }
+  size_t print(double value, int digits = 2){ return printf("%.*f", digits, value); }
+  size_t print(const Printable &value){ return value.printTo(*this); }
+  size_t println(){ return write("\r\n"); }
+  template<typename T> size_t println(const T &value){ size_t n = print(value); return n + println(); }
+  template<typename T> size_t println(const T &value, int format){ size_t n = print(value, format); return n + println(); }
+  virtual void flush(){}
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long timeout){ timeout_ms = timeout; }
+  size_t readBytes(char *buffer, size_t length){
+    size_t n = 0;
+    while(n < length){
+      int c = timed_read();
+      if(c < 0)
+        break;
+      buffer[n++] = (char)c;
+    }
+    return n;
+  }
+  size_t readBytes(uint8_t *buffer, size_t length){ return readBytes((char*)buffer, length); }
+  size_t readBytesUntil(char terminator, char *buffer, size_t length){
+    size_t n = 0;
+    while(n < length){
+      int c = timed_read();
+      if(c < 0 || c == terminator)
+        break;
+      buffer[n++] = (char)c;
+    }
+    return n;
+  }
+ protected:
+  unsigned long timeout_ms = 1000;
+  int timed_read();
+};
+
+//==============================================================
+// Time and GPIO
+inline std::chrono::steady_clock::time_point mock_start_time(){
+  static std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return start;
+}
+inline unsigned long micros(){
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - mock_start_time()).count();
+}
+inline unsigned long millis(){ return micros()/1000; }
+inline void delay(unsigned long ms){ std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us){ std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield(){ std::this_thread::yield(); }
+
+inline int Stream::timed_read(){
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if(c >= 0)
+      return c;
+    yield();
+  } while(millis() - start < timeout_ms);
+  return -1;
+}
+
+// all pins read HIGH (no button pressed) unless a test sets them
+uint8_t mock_pin_level[40];
+inline void pinMode(uint8_t pin, uint8_t mode){
+  if(pin < sizeof(mock_pin_level))
+    mock_pin_level[pin] = HIGH;
+}
+inline int digitalRead(uint8_t pin){ return pin < sizeof(mock_pin_level) ? mock_pin_level[pin] : HIGH; }
+
+//==============================================================
+// Serial connection on stdout
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long){}
+  size_t write(uint8_t c){ return fputc(c, stdout) == EOF ? 0 : 1; }
+  size_t write(const uint8_t *buffer, size_t size){ return fwrite(buffer, 1, size, stdout); }
+  int available(){ return 0; }
+  int read(){ return -1; }
+  int peek(){ return -1; }
+  void flush(){ fflush(stdout); }
+};
+HardwareSerial Serial;
+
+#include "freertos_mock.h"
+#include "esp_mock.h"
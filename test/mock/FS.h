@@ -0,0 +1,68 @@
+/**************************************************************************
+ * Host mock of the Arduino file system: the files are host files
+ * below mock_fs_root (the SD card is a directory of the host)
+**************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <memory>
+#include <sys/stat.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+std::string mock_fs_root = ".";
+
+namespace fs {
+
+class File : public Stream {
+ public:
+  File() {}
+  explicit File(FILE *file) : file(file, fclose) {}
+  size_t write(uint8_t c){ return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size){ return file ? fwrite(buffer, 1, size, file.get()) : 0; }
+  int available(){
+    if(!file)
+      return 0;
+    // without a seek, that would drop the read buffer
+    struct stat info;
+    if(fstat(fileno(file.get()), &info) != 0)
+      return 0;
+    return (int)std::max((long)info.st_size - ftell(file.get()), 0L);
+  }
+  int read(){ return file ? fgetc(file.get()) : -1; }
+  size_t read(uint8_t *buffer, size_t size){ return file ? fread(buffer, 1, size, file.get()) : 0; }
+  int peek(){
+    if(!file)
+      return -1;
+    int c = fgetc(file.get());
+    if(c != EOF)
+      ungetc(c, file.get());
+    return c;
+  }
+  void flush(){ if(file) fflush(file.get()); }
+  void close(){ file.reset(); }
+  operator bool() const { return (bool)file; }
+ private:
+  std::shared_ptr<FILE> file;
+};
+
+class FS {
+ public:
+  File open(const char *path, const char *mode = FILE_READ){
+    const char *host_mode = (mode[0] == 'w') ? "wb" : (mode[0] == 'a' ? "ab" : "rb");
+    FILE *file = fopen(host_path(path).c_str(), host_mode);
+    return file ? File(file) : File();
+  }
+  bool exists(const char *path){
+    struct stat info;
+    return stat(host_path(path).c_str(), &info) == 0;
+  }
+  bool mkdir(const char *path){ return ::mkdir(host_path(path).c_str(), 0777) == 0; }
+  bool remove(const char *path){ return ::remove(host_path(path).c_str()) == 0; }
+ private:
+  std::string host_path(const char *path){ return mock_fs_root + path; }
+};
+
+}
+using fs::File;
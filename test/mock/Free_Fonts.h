@@ -0,0 +1,7 @@
+#pragma once
+// the free fonts of the M5Stack library used by main.cpp, see M5Stack.h
+#include <M5Stack.h>
+#define FF1 (&FreeMono9pt7b)
+#define FF2 (&FreeMono12pt7b)
+#define FF3 (&FreeMono18pt7b)
+#define FF4 (&FreeMono24pt7b)
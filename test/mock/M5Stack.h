@@ -0,0 +1,247 @@
+/**************************************************************************
+ * Host mock of the M5Stack library
+ *
+ * The display is a framebuffer of RGB 565 pixels. The lines are
+ * Bresenham lines, the text is drawn as a pattern of the character
+ * codes in cells of the font size, so the tests see where and what
+ * was written, but not the real glyphs.
+ * The display counts the drawing calls and the written pixels.
+**************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include "SD.h"
+
+#define TFT_WIDTH 240
+#define TFT_HEIGHT 320
+#define BUTTON_A_PIN 39
+#define BUTTON_B_PIN 38
+#define BUTTON_C_PIN 37
+
+// colours (RGB 565)
+#define BLACK 0x0000
+#define NAVY 0x000F
+#define DARKGREEN 0x03E0
+#define MAROON 0x7800
+#define PURPLE 0x780F
+#define OLIVE 0x7BE0
+#define LIGHTGREY 0xC618
+#define DARKGREY 0x7BEF
+#define BLUE 0x001F
+#define GREEN 0x07E0
+#define CYAN 0x07FF
+#define RED 0xF800
+#define MAGENTA 0xF81F
+#define YELLOW 0xFFE0
+#define WHITE 0xFFFF
+#define ORANGE 0xFD20
+
+// text datum of drawString()
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define CC_DATUM 4
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+// free font with the size of one character cell
+struct GFXfont {
+  int width;
+  int height;
+};
+const GFXfont FreeMono9pt7b = {11, 18};
+const GFXfont FreeMono12pt7b = {14, 24};
+const GFXfont FreeMono18pt7b = {21, 35};
+const GFXfont FreeMono24pt7b = {28, 47};
+
+class TFT_eSPI : public Print {
+ public:
+  uint16_t frame[TFT_WIDTH][TFT_HEIGHT];
+  // number of drawing calls and of written pixels
+  unsigned long draw_calls = 0;
+  unsigned long pixels = 0;
+
+  int16_t width(){ return TFT_HEIGHT; }
+  int16_t height(){ return TFT_WIDTH; }
+  void setBrightness(uint8_t brightness){}
+
+  void fillScreen(uint32_t color){
+    draw_calls++;
+    fill(0, 0, TFT_HEIGHT, TFT_WIDTH, color);
+  }
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color){
+    draw_calls++;
+    fill(x, y, w, h, color);
+  }
+  void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color){
+    draw_calls++;
+    fill(x, y, w, 1, color);
+    fill(x, y+h-1, w, 1, color);
+    fill(x, y+1, 1, h-2, color);
+    fill(x+w-1, y+1, 1, h-2, color);
+  }
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color){
+    draw_calls++;
+    fill(x, y, 1, h, color);
+  }
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color){
+    draw_calls++;
+    fill(x, y, w, 1, color);
+  }
+  void drawPixel(int32_t x, int32_t y, uint32_t color){
+    draw_calls++;
+    pixel(x, y, color);
+  }
+  void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color){
+    draw_calls++;
+    int32_t dx = abs(x1-x0), sx = x0 < x1 ? 1 : -1;
+    int32_t dy = -abs(y1-y0), sy = y0 < y1 ? 1 : -1;
+    int32_t error = dx + dy;
+    while(true){
+      pixel(x0, y0, color);
+      if(x0 == x1 && y0 == y1)
+        break;
+      int32_t e2 = 2*error;
+      if(e2 >= dy){
+        error += dy;
+        x0 += sx;
+      }
+      if(e2 <= dx){
+        error += dx;
+        y0 += sy;
+      }
+    }
+  }
+  // RGB 888 of the pixels like the ILI9341 returns them
+  void readRectRGB(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t *data){
+    for(int32_t j=y; j<y+h; j++){
+      for(int32_t i=x; i<x+w; i++){
+        uint16_t color = (i >= 0 && i < TFT_HEIGHT && j >= 0 && j < TFT_WIDTH) ? frame[j][i] : 0;
+        *data++ = (color >> 8) & 0xF8;
+        *data++ = (color >> 3) & 0xFC;
+        *data++ = (color << 3) & 0xF8;
+      }
+    }
+  }
+
+  void setCursor(int16_t x, int16_t y){
+    cursor_x = x;
+    cursor_y = y;
+  }
+  void setTextColor(uint16_t color){
+    text_color = color;
+    text_background = -1;
+  }
+  void setTextColor(uint16_t color, uint16_t background){
+    text_color = color;
+    text_background = background;
+  }
+  void setTextSize(uint8_t size){ text_size = std::max((int)size, 1); }
+  void setTextFont(uint8_t font){
+    free_font = NULL;
+    text_font = font;
+  }
+  void setFreeFont(const GFXfont *font){ free_font = font; }
+  void setTextDatum(uint8_t datum){ text_datum = datum; }
+  void setTextPadding(uint16_t width){ text_padding = width; }
+  int16_t textWidth(const char *text, uint8_t font = 1){ return strlen(text) * cell_width(font); }
+  int16_t fontHeight(int16_t font = 1){ return cell_height(font); }
+
+  // text at a position given by the datum, returns the width
+  int16_t drawString(const char *text, int32_t x, int32_t y, uint8_t font){
+    draw_calls++;
+    int w = textWidth(text, font);
+    int h = cell_height(font);
+    x -= (text_datum % 3) * w / 2;
+    y -= (text_datum / 3) * h / 2;
+    if(text_padding > w && text_background >= 0){
+      int left = x - (text_datum % 3) * (text_padding - w) / 2;
+      fill(left, y, text_padding, h, text_background);
+    }
+    for(const char *c = text; *c; c++, x += cell_width(font))
+      glyph(*c, x, y, font);
+    return w;
+  }
+  // print() at the cursor, a free font writes above the base line
+  size_t write(uint8_t c){
+    draw_calls++;
+    int w = cell_width(1);
+    int h = cell_height(1);
+    if(c == '\n'){
+      cursor_x = 0;
+      cursor_y += h;
+      return 1;
+    }
+    if(c == '\r')
+      return 1;
+    if(cursor_x + w > width()){
+      cursor_x = 0;
+      cursor_y += h;
+    }
+    glyph(c, cursor_x, free_font != NULL ? cursor_y - h*3/4 : cursor_y, 1);
+    cursor_x += w;
+    return 1;
+  }
+
+ private:
+  int16_t cursor_x = 0;
+  int16_t cursor_y = 0;
+  uint16_t text_color = WHITE;
+  int32_t text_background = -1;
+  int text_size = 1;
+  int text_font = 1;
+  const GFXfont *free_font = NULL;
+  uint8_t text_datum = TL_DATUM;
+  uint16_t text_padding = 0;
+
+  // character cell of a font (1 = the free font if one is set)
+  int cell_width(int font){
+    if(font == 1 && free_font != NULL)
+      return free_font->width;
+    return (font == 4 ? 14 : (font == 2 ? 8 : 6)) * text_size;
+  }
+  int cell_height(int font){
+    if(font == 1 && free_font != NULL)
+      return free_font->height;
+    return (font == 4 ? 26 : (font == 2 ? 16 : 8)) * text_size;
+  }
+  // a pattern of the character code instead of the glyph
+  void glyph(char c, int x, int y, int font){
+    int w = cell_width(font);
+    int h = cell_height(font);
+    if(text_background >= 0)
+      fill(x, y, w, h, text_background);
+    if(c == ' ')
+      return;
+    uint32_t code = (uint8_t)c * 2654435761UL;
+    for(int j=1; j<h-1; j++){
+      for(int i=1; i<w-1; i++){
+        if((code >> ((i*7 + j*3) % 29)) & 1)
+          pixel(x+i, y+j, text_color);
+      }
+    }
+  }
+  void pixel(int32_t x, int32_t y, uint32_t color){
+    if(x >= 0 && x < TFT_HEIGHT && y >= 0 && y < TFT_WIDTH){
+      frame[y][x] = color;
+      pixels++;
+    }
+  }
+  void fill(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color){
+    for(int32_t j=y; j<y+h; j++){
+      for(int32_t i=x; i<x+w; i++)
+        pixel(i, j, color);
+    }
+  }
+};
+
+class M5Stack {
+ public:
+  void begin(bool lcd = true, bool sd = true, bool serial = true, bool i2c = false){}
+  void update(){}
+  TFT_eSPI Lcd;
+};
+M5Stack M5;
@@ -0,0 +1,30 @@
+/**************************************************************************
+ * Host mock of the Preferences (NVS) library: kept in memory
+**************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <map>
+
+class Preferences {
+ public:
+  bool begin(const char *name, bool read_only = false){
+    space = name;
+    return true;
+  }
+  void end(){ space.clear(); }
+  uint32_t getUInt(const char *key, uint32_t default_value = 0){
+    std::map<std::string, uint32_t>::iterator entry = values().find(space + "/" + key);
+    return entry == values().end() ? default_value : entry->second;
+  }
+  size_t putUInt(const char *key, uint32_t value){
+    values()[space + "/" + key] = value;
+    return sizeof(value);
+  }
+  // all values of all name spaces, so a test can check them
+  static std::map<std::string, uint32_t> &values(){
+    static std::map<std::string, uint32_t> stored;
+    return stored;
+  }
+ private:
+  std::string space;
+};
@@ -0,0 +1,9 @@
+#pragma once
+// SD card of the M5Stack, see FS.h
+#include "FS.h"
+
+class SDFS : public fs::FS {
+ public:
+  bool begin(){ return true; }
+};
+SDFS SD;
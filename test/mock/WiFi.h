@@ -0,0 +1,173 @@
+/**************************************************************************
+ * Host mock of the WiFi library
+ *
+ * The station is never connected. The clients and the server are
+ * POSIX sockets that only reach numeric addresses, so a test can
+ * send requests to the server of main.cpp over the loopback
+ * interface. Ports below 1024 are moved up by MOCK_PORT_OFFSET to
+ * run without root. Both ends send without delay (TCP_NODELAY).
+**************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <memory>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MOCK_PORT_OFFSET 8000
+
+inline uint16_t mock_port(uint16_t port){
+  return port < 1024 ? port + MOCK_PORT_OFFSET : port;
+}
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+typedef enum {WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3} wifi_mode_t;
+
+class IPAddress : public Printable {
+ public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0){
+    bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d;
+  }
+  String toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+    return String(text);
+  }
+  size_t printTo(Print &p) const { return p.print(toString()); }
+ private:
+  uint8_t bytes[4];
+};
+
+// socket of a connection, closed with the last client that uses it
+struct mock_socket_t {
+  int fd;
+  mock_socket_t(int fd) : fd(fd) {
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  }
+  ~mock_socket_t(){ close(fd); }
+};
+
+class WiFiClient : public Stream {
+ public:
+  WiFiClient(){}
+  WiFiClient(int fd) : socket(std::make_shared<mock_socket_t>(fd)) {}
+  virtual ~WiFiClient() {}
+  virtual int connect(const char *host, uint16_t port){
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(mock_port(port));
+    if(inet_pton(AF_INET, host, &address.sin_addr) != 1)
+      return 0;
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0)
+      return 0;
+    if(::connect(fd, (sockaddr*)&address, sizeof(address)) != 0){
+      close(fd);
+      return 0;
+    }
+    socket = std::make_shared<mock_socket_t>(fd);
+    return 1;
+  }
+  // connected while there is data to read or the peer did not close
+  uint8_t connected(){
+    if(!socket)
+      return 0;
+    char c;
+    ssize_t n = recv(socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+  }
+  void stop(){ socket.reset(); }
+  operator bool(){ return connected(); }
+  size_t write(uint8_t c){ return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size){
+    size_t sent = 0;
+    while(socket && sent < size){
+      ssize_t n = send(socket->fd, buffer+sent, size-sent, MSG_NOSIGNAL);
+      if(n <= 0)
+        break;
+      sent += n;
+    }
+    return sent;
+  }
+  int available(){
+    int n = 0;
+    if(!socket || ioctl(socket->fd, FIONREAD, &n) != 0)
+      return 0;
+    return n;
+  }
+  int read(){
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int read(uint8_t *buffer, size_t size){
+    if(!socket)
+      return -1;
+    ssize_t n = recv(socket->fd, buffer, size, MSG_DONTWAIT);
+    return n > 0 ? n : -1;
+  }
+  int peek(){
+    uint8_t c;
+    if(!socket || recv(socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1)
+      return -1;
+    return c;
+  }
+ private:
+  std::shared_ptr<mock_socket_t> socket;
+};
+
+// listens on the loopback interface only
+class WiFiServer {
+ public:
+  WiFiServer(uint16_t port) : port(port) {}
+  void begin(){
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(mock_port(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 8) != 0){
+      perror("WiFiServer");
+      return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+  }
+  // the next connection or a client that is not connected
+  WiFiClient available(){
+    int client = fd < 0 ? -1 : accept(fd, NULL, NULL);
+    if(client < 0)
+      return WiFiClient();
+    return WiFiClient(client);
+  }
+ private:
+  uint16_t port;
+  int fd = -1;
+};
+
+class WiFiClass {
+ public:
+  wl_status_t status(){ return WL_DISCONNECTED; }
+  void mode(wifi_mode_t mode){}
+  void begin(){}
+  void begin(const char *ssid, const char *password){}
+  void disconnect(bool wifi_off = false){}
+  int16_t scanNetworks(){ return 0; }
+  String SSID(uint8_t index){ return String(); }
+  IPAddress localIP(){ return IPAddress(); }
+};
+WiFiClass WiFi;
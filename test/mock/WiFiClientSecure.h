@@ -0,0 +1,10 @@
+#pragma once
+// TLS client, see WiFi.h
+// There is no TLS, so it never connects.
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient {
+ public:
+  int connect(const char *host, uint16_t port){ return 0; }
+  void setCACert(const char *certificate){}
+};
@@ -0,0 +1,3 @@
+#pragma once
+// GPIO functions of the ESP-IDF, see esp_mock.h
+#include <Arduino.h>
@@ -0,0 +1,85 @@
+/**************************************************************************
+ * Host mock of the ESP-IDF functions used by main.cpp
+ *
+ * The heap is a DRAM of MOCK_HEAP_SIZE bytes: the free bytes are
+ * this size minus the bytes allocated on the host (glibc only) and
+ * the allocated blocks are the live blocks of operator new.
+ * The light sleep returns at once.
+**************************************************************************/
+#pragma once
+#include <new>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#define MOCK_HEAP_SIZE 300000
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#define MALLOC_CAP_8BIT (1<<2)
+#define MALLOC_CAP_DEFAULT (1<<12)
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+// live blocks of operator new
+long mock_heap_blocks = 0;
+size_t mock_heap_minimum = MOCK_HEAP_SIZE;
+
+void *operator new(size_t size){
+  void *block = malloc(size == 0 ? 1 : size);
+  if(block == NULL)
+    throw std::bad_alloc();
+  __atomic_add_fetch(&mock_heap_blocks, 1, __ATOMIC_RELAXED);
+  return block;
+}
+void operator delete(void *block) noexcept {
+  if(block != NULL){
+    __atomic_sub_fetch(&mock_heap_blocks, 1, __ATOMIC_RELAXED);
+    free(block);
+  }
+}
+void operator delete(void *block, size_t) noexcept { operator delete(block); }
+
+inline size_t heap_caps_get_free_size(uint32_t caps){
+  size_t used = 0;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  used = mallinfo2().uordblks;
+#endif
+  size_t free_bytes = used < MOCK_HEAP_SIZE ? MOCK_HEAP_SIZE - used : 0;
+  mock_heap_minimum = std::min(mock_heap_minimum, free_bytes);
+  return free_bytes;
+}
+inline size_t heap_caps_get_largest_free_block(uint32_t caps){ return heap_caps_get_free_size(caps); }
+inline size_t heap_caps_get_minimum_free_size(uint32_t caps){
+  heap_caps_get_free_size(caps);
+  return mock_heap_minimum;
+}
+inline void heap_caps_get_info(multi_heap_info_t *info, uint32_t caps){
+  memset(info, 0, sizeof(*info));
+  info->total_free_bytes = heap_caps_get_free_size(caps);
+  info->total_allocated_bytes = MOCK_HEAP_SIZE - info->total_free_bytes;
+  info->largest_free_block = info->total_free_bytes;
+  info->minimum_free_bytes = mock_heap_minimum;
+  info->allocated_blocks = __atomic_load_n(&mock_heap_blocks, __ATOMIC_RELAXED);
+}
+
+//==============================================================
+// GPIO wake up and light sleep
+typedef int gpio_num_t;
+typedef int gpio_int_type_t;
+#define GPIO_INTR_LOW_LEVEL 4
+#define GPIO_INTR_HIGH_LEVEL 5
+inline esp_err_t gpio_wakeup_enable(gpio_num_t pin, gpio_int_type_t type){ return ESP_OK; }
+inline esp_err_t esp_sleep_enable_gpio_wakeup(){ return ESP_OK; }
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t us){ return ESP_OK; }
+inline esp_err_t esp_light_sleep_start(){ return ESP_OK; }
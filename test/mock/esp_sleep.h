@@ -0,0 +1,3 @@
+#pragma once
+// sleep functions of the ESP-IDF, see esp_mock.h
+#include <Arduino.h>
@@ -0,0 +1,173 @@
+/**************************************************************************
+ * Host mock of the FreeRTOS API used by main.cpp
+ *
+ * Every task is a detached std::thread. Queues, semaphores and
+ * task notifications are built on a mutex and a condition variable.
+ * Ticks are milliseconds.
+**************************************************************************/
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+// wait on a condition variable for ticks (portMAX_DELAY = forever)
+template<typename Predicate>
+bool mock_wait(std::condition_variable &condition, std::unique_lock<std::mutex> &lock,
+               TickType_t ticks, Predicate ready){
+  if(ticks == portMAX_DELAY){
+    condition.wait(lock, ready);
+    return true;
+  }
+  return condition.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+//==============================================================
+// Tasks and notifications
+struct mock_task_t {
+  std::mutex mutex;
+  std::condition_variable condition;
+  uint32_t notified = 0;
+};
+typedef mock_task_t* TaskHandle_t;
+
+// the task of the calling thread (the main thread gets its own)
+inline TaskHandle_t &mock_current_task(){
+  static thread_local TaskHandle_t task = NULL;
+  if(task == NULL)
+    task = new mock_task_t();
+  return task;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*function)(void*), const char *name, uint32_t stack,
+                                          void *parameter, UBaseType_t priority,
+                                          TaskHandle_t *handle, BaseType_t core){
+  TaskHandle_t task = new mock_task_t();
+  if(handle != NULL)
+    *handle = task;
+  std::thread([function, parameter, task]{
+    mock_current_task() = task;
+    function(parameter);
+  }).detach();
+  return pdPASS;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task){
+  std::lock_guard<std::mutex> lock(task->mutex);
+  task->notified++;
+  task->condition.notify_all();
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks){
+  TaskHandle_t task = mock_current_task();
+  std::unique_lock<std::mutex> lock(task->mutex);
+  mock_wait(task->condition, lock, ticks, [task]{ return task->notified > 0; });
+  uint32_t value = task->notified;
+  if(value > 0)
+    task->notified = clear_on_exit ? 0 : value-1;
+  return value;
+}
+
+inline TickType_t xTaskGetTickCount(){ return (TickType_t)millis(); }
+inline void vTaskDelay(TickType_t ticks){ delay(ticks); }
+inline void vTaskDelayUntil(TickType_t *previous_wake, TickType_t ticks){
+  *previous_wake += ticks;
+  TickType_t now = xTaskGetTickCount();
+  if((int32_t)(*previous_wake - now) > 0)
+    delay(*previous_wake - now);
+}
+inline void vTaskDelete(TaskHandle_t task){}
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task){ return 0; }
+
+//==============================================================
+// Queues of fixed size items
+struct mock_queue_t {
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<std::vector<uint8_t> > items;
+  UBaseType_t length;
+  UBaseType_t item_size;
+};
+typedef mock_queue_t* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size){
+  QueueHandle_t queue = new mock_queue_t();
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks){
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if(!mock_wait(queue->condition, lock, ticks, [queue]{ return queue->items.size() < queue->length; }))
+    return pdFALSE;
+  const uint8_t *bytes = (const uint8_t*)item;
+  queue->items.push_back(std::vector<uint8_t>(bytes, bytes + queue->item_size));
+  queue->condition.notify_all();
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks){
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if(!mock_wait(queue->condition, lock, ticks, [queue]{ return !queue->items.empty(); }))
+    return pdFALSE;
+  memcpy(item, queue->items.front().data(), queue->item_size);
+  queue->items.pop_front();
+  queue->condition.notify_all();
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue){
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  return queue->items.size();
+}
+
+//==============================================================
+// Binary semaphores and mutexes (a mutex starts given)
+struct mock_semaphore_t {
+  std::mutex mutex;
+  std::condition_variable condition;
+  int count;
+};
+typedef mock_semaphore_t* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary(){
+  SemaphoreHandle_t semaphore = new mock_semaphore_t();
+  semaphore->count = 0;
+  return semaphore;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex(){
+  SemaphoreHandle_t semaphore = new mock_semaphore_t();
+  semaphore->count = 1;
+  return semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks){
+  std::unique_lock<std::mutex> lock(semaphore->mutex);
+  if(!mock_wait(semaphore->condition, lock, ticks, [semaphore]{ return semaphore->count > 0; }))
+    return pdFALSE;
+  semaphore->count--;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore){
+  std::lock_guard<std::mutex> lock(semaphore->mutex);
+  if(semaphore->count > 0)
+    return pdFALSE;
+  semaphore->count++;
+  semaphore->condition.notify_all();
+  return pdTRUE;
+}
@@ -0,0 +1,135 @@
+/**************************************************************************
+ * Benchmark and fuzz test of the JHU CSV parser with synthetic files
+ *
+ * The head-to-head benchmark parses the same synthetic data as JSON
+ * (pretty printed and minified) and as CSV files at 1x, 5x and 20x
+ * the days. Every series of both results is compared with the
+ * generator, so both sources give the same store.
+ * The fuzz test parses truncated and damaged CSV files and checks
+ * that the store stays consistent (pio test -e native_sanitize).
+**************************************************************************/
+#include <unity.h>
+#include "../../main.cpp"
+#include "../common/synthetic_feed.h"
+#include "../common/store_check.h"
+#include "../common/text_stream.h"
+
+#define FUZZ_CASES 64
+
+series_store_t test_store;
+
+void setUp(){
+  store = &test_store;
+  // the streams in memory never have to wait for data
+  parse_timeout_ms = 0;
+  stream_length = 0;
+}
+
+void tearDown(){}
+
+//==============================================================
+// Parse synthetic CSV files in the same order as load_csv()
+// Every pass gets a new synthetic file.
+void parse_csv(int countries, int days, uint32_t seed, unsigned long truncate_at, int mutate_rate){
+  const int passes[3][2] = {{0, 1}, {1, 1}, {0, 0}};
+  csv_begin(store);
+  for(int p=0; p<3; p++){
+    int metric = passes[p][0];
+    bool rank = passes[p][1];
+    if(!rank && !csv_missing(metric))
+      break;
+    synthetic_feed_t feed(countries, days, SYNTHETIC_CSV_CONFIRMED+metric, seed+p, truncate_at, mutate_rate);
+    process_csv(feed, metric, rank);
+  }
+  csv_finish();
+}
+
+//==============================================================
+// Values beyond CSV_MAX_VALUE saturate, in the rows and in the sum
+// of the provinces of a country. The sums of the store hold more.
+void test_saturate(){
+  text_stream_t stream(
+    "Province/State,Country/Region,Lat,Long,1/22/20,1/23/20,1/24/20\n"
+    ",Germany,51.1,10.4,5,99999999999999999999,123456789\n"
+    "A,France,1.0,2.0,1,999999999,999999999\n"
+    "B,France,1.0,2.0,1,999999999,999999999\n"
+    "C,France,1.0,2.0,1,999999999,999999999\n");
+  csv_begin(store);
+  process_csv(stream, 0, true);
+  csv_finish();
+  TEST_ASSERT_TRUE(store->valid);
+  int values[SERIES_LENGTH];
+  const int germany[3] = {5, CSV_MAX_VALUE, 123456789};
+  load_series(store, find_country("Germany"), 0, values);
+  TEST_ASSERT_EQUAL_INT_ARRAY(germany, values, 3);
+  const int france[3] = {3, CSV_MAX_VALUE, CSV_MAX_VALUE};
+  load_series(store, find_country("France"), 0, values);
+  TEST_ASSERT_EQUAL_INT_ARRAY(france, values, 3);
+  const int sum[3] = {8, 2*CSV_MAX_VALUE, CSV_MAX_VALUE + 123456789};
+  load_series(store, 0, 0, values);
+  TEST_ASSERT_EQUAL_INT_ARRAY(sum, values, 3);
+}
+
+//==============================================================
+// JSON against CSV with the same data at 1x, 5x and 20x the days
+// prints one line per file like the benchmark of test_parser
+void test_head_to_head(){
+  const char *format_name[3] = {"pretty", "minified", "csv"};
+  const int scales[3] = {1, 5, 20};
+  printf("scale  format    bytes      ms   kB/s  read ms  store ms  result\n");
+  int failed = 0;
+  for(int s=0; s<3; s++){
+    for(int format=0; format<3; format++){
+      int days = SYNTHETIC_DAYS*scales[s];
+      if(format < 2){
+        synthetic_feed_t feed(SYNTHETIC_COUNTRIES, days, format);
+        process_data(feed, store);
+      } else {
+        parse_csv(SYNTHETIC_COUNTRIES, days, 1, 0, 0);
+      }
+      unsigned long ms = parse_stats.total_us/1000;
+      int errors = check_store(store) + check_generated(store, SYNTHETIC_COUNTRIES, days);
+      const char *result = errors > 0 ? "[ERR]" : (pool_overflow ? "[FULL]" : "[OK]");
+      printf("%3ix   %-8s %9lu %7lu %6lu %8lu %9lu  %s\n", scales[s],
+             format_name[format], parse_stats.bytes, ms,
+             parse_stats.bytes/std::max(ms, 1UL), parse_stats.read_us/1000,
+             parse_stats.store_us/1000, result);
+      if(errors > 0)
+        failed++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, failed);
+}
+
+//==============================================================
+// Fuzz test with small files
+// kind 0: truncated, 1: few damaged bytes, 2: many damaged bytes,
+// 3: truncated and damaged
+void test_fuzz(){
+  int errors = 0;
+  for(int n=0; n<FUZZ_CASES; n++){
+    int kind = n % 4;
+    uint32_t seed = 2654435761UL * (n+1);
+    // length of the complete confirmed file
+    synthetic_feed_t complete(40, 40, SYNTHETIC_CSV_CONFIRMED);
+    while(complete.read() >= 0);
+    unsigned long truncate_at = 0;
+    if(kind == 0 || kind == 3)
+      truncate_at = 1 + seed % complete.bytes_read;
+    int mutate_rate = (kind == 1) ? 1000 : (kind >= 2 ? 20 : 0);
+    parse_csv(40, 40, seed, truncate_at, mutate_rate);
+    int case_errors = check_store(store);
+    if(case_errors > 0)
+      printf("fuzz case %i (kind %i): %i errors\n", n, kind, case_errors);
+    errors += case_errors;
+  }
+  TEST_ASSERT_EQUAL_INT(0, errors);
+}
+
+int main(int argc, char **argv){
+  UNITY_BEGIN();
+  RUN_TEST(test_saturate);
+  RUN_TEST(test_head_to_head);
+  RUN_TEST(test_fuzz);
+  return UNITY_END();
+}
@@ -0,0 +1,275 @@
+/**************************************************************************
+ * Comparison of the fixed point graph renderer with float renderers
+ *
+ * The positions of the fixed point renderer of the display (319/239)
+ * and of the M5StickC (159/79) are compared with the exact results
+ * for every window and the values next to every rounding step.
+ * The graphs of a synthetic store are drawn into the framebuffer of
+ * the mock display by the fixed point renderer and by a float
+ * renderer that reads the display size at runtime, and have to be
+ * equal in every pixel.
+ * The float renderer of version 1.09 is not exact in a few positions,
+ * its differences and the time of all renderers are only printed
+ * (host times, not the times of the ESP32).
+**************************************************************************/
+#include <unity.h>
+#include "../../main.cpp"
+#include "../common/synthetic_feed.h"
+
+#define BENCHMARK_REPEAT 200
+
+series_store_t test_store;
+
+void setUp(){
+  store = &test_store;
+  // the streams in memory never have to wait for data
+  parse_timeout_ms = 0;
+  stream_length = 0;
+}
+
+void tearDown(){}
+
+//==============================================================
+// Float renderer with the display size read at runtime
+// double is exact for these positions if the division comes last:
+// x is rounded down, y to the nearest pixel with the halves rounded up
+struct float_renderer_t {
+  int max_x;
+  int max_y;
+  double window;
+  double max_value;
+  float_renderer_t() : max_x(M5.Lcd.width()-1), max_y(M5.Lcd.height()-1){}
+  float_renderer_t(int width, int height) : max_x(width), max_y(height){}
+  void scale(int window, int max_value){
+    this->window = std::max(window, 1);
+    this->max_value = std::max(max_value, 1);
+  }
+  int x(int day) const {
+    return floor(double(max_x) * day / window);
+  }
+  int y(int value) const {
+    return (max_y-1) - (int)floor(double(max_y-1) * value / max_value + 0.5);
+  }
+};
+
+//==============================================================
+// Float renderer of version 1.09 (single precision)
+struct legacy_renderer_t {
+  int max_x;
+  int max_y;
+  float x_scale;
+  float y_scale;
+  legacy_renderer_t() : max_x(M5.Lcd.width()-1), max_y(M5.Lcd.height()-1){}
+  legacy_renderer_t(int width, int height) : max_x(width), max_y(height){}
+  void scale(int window, int max_value){
+    x_scale = float(max_x) / std::max(window, 1);
+    y_scale = float(max_y-1) / std::max(max_value, 1);
+  }
+  int x(int day) const {
+    return trunc(x_scale*day);
+  }
+  int y(int value) const {
+    return (max_y-1)-(round(y_scale * value));
+  }
+};
+
+//==============================================================
+// Exact positions for the highest coordinates max_x / max_y
+int exact_x(int max_x, int window, int day){
+  return (int64_t)day * max_x / window;
+}
+int exact_y(int max_y, int max_value, int value){
+  return (max_y-1) - (int)(((int64_t)value * 2*(max_y-1) + max_value) / (2*(int64_t)max_value));
+}
+
+// largest values of the graphs
+const int max_values[] = {1, 2, 3, 7, 100, 238, 239, 1000, 4095, 65535, 123457,
+                          1000003, 99999989, 999999999, 2147483647};
+const int n_max_values = sizeof(max_values) / sizeof(max_values[0]);
+
+//==============================================================
+// Positions of a renderer that differ from the exact positions
+// (every window, every value next to a rounding step)
+template<class renderer_t>
+long position_differences(renderer_t &graph, int max_x, int max_y){
+  long differences = 0;
+  for(int window=1; window<=SERIES_LENGTH; window++){
+    graph.scale(window, 1);
+    for(int day=0; day<=window; day++)
+      differences += (graph.x(day) != exact_x(max_x, window, day));
+  }
+  for(int m=0; m<n_max_values; m++){
+    int max_value = max_values[m];
+    graph.scale(1, max_value);
+    for(int pixel=0; pixel<max_y; pixel++){
+      // first value that is rounded to pixel+1
+      int64_t step = ((int64_t)(2*pixel+1) * max_value + 2*(max_y-1) - 1) / (2*(max_y-1));
+      for(int64_t value = step-1; value <= step; value++){
+        if(value >= 0 && value <= max_value)
+          differences += (graph.y(value) != exact_y(max_y, max_value, value));
+      }
+    }
+  }
+  return differences;
+}
+
+void test_positions(){
+  graph_renderer display;
+  graph_renderer_t<159, 79> stick;
+  float_renderer_t display_float;
+  float_renderer_t stick_float(159, 79);
+  legacy_renderer_t display_legacy;
+  legacy_renderer_t stick_legacy(159, 79);
+  TEST_ASSERT_EQUAL_INT(0, position_differences(display, 319, 239));
+  TEST_ASSERT_EQUAL_INT(0, position_differences(stick, 159, 79));
+  TEST_ASSERT_EQUAL_INT(0, position_differences(display_float, 319, 239));
+  TEST_ASSERT_EQUAL_INT(0, position_differences(stick_float, 159, 79));
+  printf("positions of the 1.09 renderer that differ: display %li, M5StickC %li\n",
+         position_differences(display_legacy, 319, 239), position_differences(stick_legacy, 159, 79));
+}
+
+//==============================================================
+// Load the synthetic store and select 5 countries
+void load_synthetic(){
+  synthetic_feed_t feed(SYNTHETIC_COUNTRIES, SYNTHETIC_DAYS, SYNTHETIC_MINIFIED);
+  process_data(feed, store);
+  const int selection[6] = {0, 1, 5, 12, 27, 40};
+  for(int n=0; n<6; n++)
+    country_selection[n] = selection[n];
+  view_data_index = -1;
+}
+
+//==============================================================
+// Weekly grid and the days first..first+window-1 of the 5
+// selected countries like display_data_graph()
+template<class renderer_t>
+void draw_graph(renderer_t &graph, int height, int first, int window, int max_value){
+  graph.scale(window, max_value);
+  for(int day=0; day<window; day+=7)
+    M5.Lcd.drawFastVLine(graph.x(day), 0, height, 0x528A);
+  for(int n=1; n<6; n++){
+    int count = store->series[view_series[n]].count;
+    for(int i=std::max(first+1, 1); i<std::min(first+window, count); i++)
+      M5.Lcd.drawLine(graph.x(i-1-first), graph.y(view_data[n][i-1]),
+                      graph.x(i-first), graph.y(view_data[n][i]), country_color[n]);
+  }
+}
+
+// largest value of the days first..first+window-1
+int window_max(int first, int window){
+  int max_value = 0;
+  for(int n=1; n<6; n++){
+    int count = store->series[view_series[n]].count;
+    for(int i=std::max(first, 0); i<std::min(first+window, count); i++)
+      max_value = std::max(max_value, view_data[n][i]);
+  }
+  return max_value;
+}
+
+// pixels that differ between the framebuffer and a copy
+long frame_differences(const uint16_t (*frame)[TFT_HEIGHT]){
+  long differences = 0;
+  for(int y=0; y<TFT_WIDTH; y++){
+    for(int x=0; x<TFT_HEIGHT; x++)
+      differences += (frame[y][x] != M5.Lcd.frame[y][x]);
+  }
+  return differences;
+}
+
+//==============================================================
+// The fixed point and the float renderer draw the same pixels
+// (all days and zoomed windows, display and M5StickC geometry)
+void test_pixels(){
+  static uint16_t reference[TFT_WIDTH][TFT_HEIGHT];
+  load_synthetic();
+  int count = store->series[country_selection[1]].count;
+  TEST_ASSERT_GREATER_THAN(0, count);
+  const int windows[4][2] = {{0, count}, {count/2, count/2}, {count-30, 30}, {count-7, 7}};
+  long legacy_differences = 0;
+  for(int data_index=0; data_index<2; data_index++){
+    load_view(data_index);
+    for(int w=0; w<4; w++){
+      int first = windows[w][0];
+      int window = windows[w][1];
+      int max_value = window_max(first, window);
+      M5.Lcd.fillScreen(BLACK);
+      float_renderer_t display_float;
+      draw_graph(display_float, 239, first, window, max_value);
+      float_renderer_t stick_float(159, 79);
+      draw_graph(stick_float, 79, first, window, max_value);
+      memcpy(reference, M5.Lcd.frame, sizeof(reference));
+      M5.Lcd.fillScreen(BLACK);
+      graph_renderer display;
+      draw_graph(display, 239, first, window, max_value);
+      graph_renderer_t<159, 79> stick;
+      draw_graph(stick, 79, first, window, max_value);
+      TEST_ASSERT_EQUAL_INT(0, frame_differences(reference));
+      M5.Lcd.fillScreen(BLACK);
+      legacy_renderer_t display_legacy;
+      draw_graph(display_legacy, 239, first, window, max_value);
+      legacy_renderer_t stick_legacy(159, 79);
+      draw_graph(stick_legacy, 79, first, window, max_value);
+      legacy_differences += frame_differences(reference);
+    }
+  }
+  printf("pixels of the 1.09 renderer that differ: %li\n", legacy_differences);
+}
+
+//==============================================================
+// Positions of all days of the 5 selected countries
+// The checksum keeps the compiler from dropping the calculation.
+template<class renderer_t>
+uint32_t graph_kernel(renderer_t &graph, int max_value){
+  uint32_t sum = 0;
+  for(int n=1; n<6; n++){
+    int count = store->series[view_series[n]].count;
+    graph.scale(count, max_value);
+    for(int i=0; i<count; i++)
+      sum += graph.x(i)*65599 + graph.y(view_data[n][i]);
+  }
+  return sum;
+}
+
+// time to calculate the positions and to draw the graph
+template<class renderer_t>
+void benchmark(const char *name, renderer_t &graph, int positions){
+  int count = store->series[view_series[1]].count;
+  int max_value = window_max(0, count);
+  uint32_t sum = 0;
+  unsigned long start = micros();
+  for(int r=0; r<BENCHMARK_REPEAT; r++)
+    sum += graph_kernel(graph, max_value);
+  unsigned long kernel_us = micros() - start;
+  M5.Lcd.fillScreen(BLACK);
+  start = micros();
+  draw_graph(graph, 239, 0, count, max_value);
+  unsigned long draw_us = micros() - start;
+  printf("%-12s %8lu %8lu %10lu   %08x\n", name, kernel_us,
+         (unsigned long)((unsigned long long)kernel_us*1000/(positions*BENCHMARK_REPEAT)),
+         draw_us, (unsigned)sum);
+}
+
+void test_benchmark(){
+  load_synthetic();
+  load_view(0);
+  int positions = 0;
+  for(int n=1; n<6; n++)
+    positions += store->series[view_series[n]].count;
+  TEST_ASSERT_GREATER_THAN(0, positions);
+  printf("%i positions x %i\n", positions, BENCHMARK_REPEAT);
+  printf("renderer     kernel/us  ns/pos   draw/us   checksum\n");
+  legacy_renderer_t legacy;
+  benchmark("float 1.09", legacy, positions);
+  float_renderer_t generic;
+  benchmark("float", generic, positions);
+  graph_renderer fixed;
+  benchmark("fixed point", fixed, positions);
+}
+
+int main(int argc, char **argv){
+  UNITY_BEGIN();
+  RUN_TEST(test_positions);
+  RUN_TEST(test_pixels);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,177 @@
+/**************************************************************************
+ * Benchmark and fuzz test of the JSON parser with synthetic files
+ *
+ * The benchmark parses files of the current size (1x) and of 5x and
+ * 20x the days, pretty printed and minified, and compares every
+ * series of the store, the sums included, with the generator.
+ * The fuzz test parses truncated and damaged files and checks that
+ * the store stays consistent. Run it in the native_sanitize
+ * environment to find overruns:
+ *   pio test -e native_sanitize -f test_parser
+**************************************************************************/
+#include <unity.h>
+#include "../../main.cpp"
+#include "../common/synthetic_feed.h"
+#include "../common/store_check.h"
+#include "../common/text_stream.h"
+
+#define FUZZ_CASES 64
+
+series_store_t test_store;
+
+void setUp(){
+  store = &test_store;
+  // the streams in memory never have to wait for data
+  parse_timeout_ms = 0;
+  stream_length = 0;
+}
+
+void tearDown(){}
+
+//==============================================================
+// A country that ends before the last date of the file keeps its
+// last value in the sums (the days of a country have gaps).
+void test_sums_carry_forward(){
+  #define DAY(date, confirmed) "    {\n      \"date\": \"" date "\",\n      \"confirmed\": " #confirmed \
+                               ",\n      \"deaths\": 0,\n      \"recovered\": 0\n    }"
+  text_stream_t stream("{\n"
+    "  \"Germany\": [\n" DAY("2020-1-22", 1) ",\n" DAY("2020-1-23", 2) ",\n" DAY("2020-1-24", 3) ",\n"
+                         DAY("2020-1-25", 4) ",\n" DAY("2020-1-26", 5) "\n  ],\n"
+    "  \"France\": [\n" DAY("2020-1-24", 10) ",\n" DAY("2020-1-26", 30) "\n  ],\n"
+    "  \"Spain\": [\n" DAY("2020-1-22", 100) ",\n" DAY("2020-1-24", 300) "\n  ],\n"
+    "  \"US\": [\n" DAY("2020-1-22", 1000) ",\n" DAY("2020-1-23", 2000) "\n  ]\n"
+    "}\n");
+  #undef DAY
+  process_data(stream, store);
+  TEST_ASSERT_TRUE(store->valid);
+  // "All countries" and "Europe" (without the US)
+  const int expected[2][5] = {{1101, 2102, 2313, 2314, 2335}, {101, 102, 313, 314, 335}};
+  int values[SERIES_LENGTH];
+  for(int i=0; i<2; i++){
+    TEST_ASSERT_EQUAL_INT(5, store->series[i].count);
+    load_series(store, i, 0, values);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected[i], values, 5);
+    TEST_ASSERT_EQUAL_INT(expected[i][4], store->series[i].latest[0]);
+  }
+}
+
+//==============================================================
+// The export has no differences for the days without a day
+// before (new_*) or without a day 7 days before (new_confirmed_7d)
+void test_export_csv(){
+  #define DAY(date, confirmed) "    {\n      \"date\": \"" date "\",\n      \"confirmed\": " #confirmed \
+                               ",\n      \"deaths\": 1,\n      \"recovered\": 0\n    }"
+  text_stream_t stream("{\n"
+    "  \"Germany\": [\n" DAY("2020-1-22", 1) ",\n" DAY("2020-1-23", 3) ",\n" DAY("2020-1-24", 6) ",\n"
+                         DAY("2020-1-25", 10) ",\n" DAY("2020-1-26", 15) ",\n" DAY("2020-1-27", 21) ",\n"
+                         DAY("2020-1-28", 28) ",\n" DAY("2020-1-29", 36) ",\n" DAY("2020-1-30", 45) "\n  ]\n"
+    "}\n");
+  #undef DAY
+  process_data(stream, store);
+  TEST_ASSERT_TRUE(store->valid);
+  text_print_t out;
+  export_csv(out);
+  char rows[3][64];
+  int germany = find_country("Germany");
+  snprintf(rows[0], sizeof(rows[0]), "\n%i,\"Germany\",2020-1-22,1,1,,,\n", germany);
+  snprintf(rows[1], sizeof(rows[1]), "\n%i,\"Germany\",2020-1-28,28,1,7,0,\n", germany);
+  snprintf(rows[2], sizeof(rows[2]), "\n%i,\"Germany\",2020-1-29,36,1,8,0,35\n", germany);
+  for(int r=0; r<3; r++)
+    TEST_ASSERT_TRUE_MESSAGE(out.text.find(rows[r]) != std::string::npos, rows[r]);
+  TEST_ASSERT_TRUE(out.text.find("\n0,\"All countries\",2020-1-22,1,1,,,\n") != std::string::npos);
+}
+
+//==============================================================
+// The index and the region computed by the compiler match the
+// country tables for every name of the catalog
+void test_country_lookup(){
+  for(int c=0; c<n_catalog_countries; c++){
+    const char *name = country_catalog[c].name;
+    int index = 0;
+    for(int n=2; n<n_countries; n++){
+      if(strcmp(country_names[n], name) == 0)
+        index = n;
+    }
+    bool europe = false;
+    for(int n=0; n<n_europe_countries; n++){
+      if(strcmp(europe_names[n], name) == 0)
+        europe = true;
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(index, find_country(name), name);
+    TEST_ASSERT_TRUE_MESSAGE(is_europe(name) == europe, name);
+  }
+  TEST_ASSERT_EQUAL_INT(0, find_country("Country 42"));
+  TEST_ASSERT_FALSE(is_europe("Country 42"));
+  TEST_ASSERT_FALSE(is_europe(""));
+}
+
+//==============================================================
+// Parse the files of 1x, 5x and 20x the days
+// prints one line per file with the throughput, the time spent
+// reading the stream and storing the days, and the heap
+void test_benchmark(){
+  const char *format_name[2] = {"pretty", "minified"};
+  const int scales[3] = {1, 5, 20};
+  printf("scale  format    bytes      ms   kB/s  read ms  store ms  min heap  blocks  result\n");
+  int failed = 0;
+  for(int s=0; s<3; s++){
+    for(int format=0; format<2; format++){
+      int days = SYNTHETIC_DAYS*scales[s];
+      synthetic_feed_t feed(SYNTHETIC_COUNTRIES, days, format);
+      process_data(feed, store);
+      unsigned long ms = parse_stats.total_us/1000;
+      int errors = check_store(store) + check_generated(store, SYNTHETIC_COUNTRIES, days);
+      // [FULL]: the file was parsed, but series were shortened to fit into the pool
+      const char *result = errors > 0 ? "[ERR]" : (pool_overflow ? "[FULL]" : "[OK]");
+      printf("%3ix   %-8s %9lu %7lu %6lu %8lu %9lu %9u %7i  %s\n", scales[s],
+             format_name[format], parse_stats.bytes, ms,
+             parse_stats.bytes/std::max(ms, 1UL), parse_stats.read_us/1000,
+             parse_stats.store_us/1000, (unsigned)parse_stats.min_free_heap,
+             parse_stats.heap_blocks, result);
+      if(errors > 0)
+        failed++;
+    }
+  }
+  TEST_ASSERT_EQUAL_INT(0, failed);
+}
+
+//==============================================================
+// Fuzz test with small files
+// kind 0: truncated, 1: few damaged bytes, 2: many damaged bytes,
+// 3: truncated and damaged
+void test_fuzz(){
+  int errors = 0;
+  for(int n=0; n<FUZZ_CASES; n++){
+    int kind = n % 4;
+    int format = (n/4) % 2;
+    uint32_t seed = 2654435761UL * (n+1);
+    // length of the complete file up to the closing "}"
+    synthetic_feed_t complete(40, 40, format);
+    while(complete.read() >= 0);
+    unsigned long length = complete.bytes_read - (format == SYNTHETIC_PRETTY ? 1 : 0);
+    unsigned long truncate_at = 0;
+    if(kind == 0 || kind == 3)
+      truncate_at = 1 + seed % length;
+    int mutate_rate = (kind == 1) ? 1000 : (kind >= 2 ? 20 : 0);
+    synthetic_feed_t feed(40, 40, format, seed, truncate_at, mutate_rate);
+    process_data(feed, store);
+    int case_errors = check_store(store);
+    // an undamaged but truncated file must never be accepted
+    if(kind == 0 && store->valid && truncate_at < length)
+      case_errors++;
+    if(case_errors > 0)
+      printf("fuzz case %i (kind %i, format %i): %i errors\n", n, kind, format, case_errors);
+    errors += case_errors;
+  }
+  TEST_ASSERT_EQUAL_INT(0, errors);
+}
+
+int main(int argc, char **argv){
+  UNITY_BEGIN();
+  RUN_TEST(test_sums_carry_forward);
+  RUN_TEST(test_export_csv);
+  RUN_TEST(test_country_lookup);
+  RUN_TEST(test_benchmark);
+  RUN_TEST(test_fuzz);
+  return UNITY_END();
+}
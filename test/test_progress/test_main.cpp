@@ -0,0 +1,114 @@
+/**************************************************************************
+ * Redraw cost of the progress display while a file is parsed
+ *
+ * v1.09 cleared the full screen and drew the percentage at the start
+ * of every country (legacy_progress() of the PROGRESS_BENCHMARK
+ * mode). The progress task only draws the grown part of the bar and
+ * two text lines every PROGRESS_INTERVAL_MS.
+ * Both are drawn into the framebuffer of the mock display while the
+ * 1x synthetic file is parsed. The written pixels are what the ESP32
+ * sends over the SPI bus, the time on the device is estimated from
+ * them at TFT_SPI_MHZ with 16 bit per pixel. The host times are
+ * printed as well, they are no device times.
+**************************************************************************/
+#define PROGRESS_BENCHMARK
+#include <unity.h>
+#include "../../main.cpp"
+
+// SPI clock of the display of the M5Stack
+#define TFT_SPI_MHZ 40
+// the parse of the file is slowed down to this time, like a
+// download (the 1x file needs about 20 s over WiFi)
+#define DOWNLOAD_MS 2000
+
+series_store_t test_store;
+
+void setUp(){
+  store = &test_store;
+  // the streams in memory never have to wait for data
+  parse_timeout_ms = 0;
+  stream_length = 0;
+}
+
+void tearDown(){}
+
+//==============================================================
+// The synthetic file at the speed of a download
+class download_t : public Stream {
+ public:
+  download_t(unsigned long length) : feed(SYNTHETIC_COUNTRIES, SYNTHETIC_DAYS, SYNTHETIC_PRETTY),
+                                     length(length), start(millis()) {}
+  int available(){ return feed.available(); }
+  int read(){
+    // wait until the byte would have been received
+    if(++bytes % 4096 == 0){
+      unsigned long due = (uint64_t)bytes * DOWNLOAD_MS / length;
+      while(millis() - start < due)
+        delay(1);
+    }
+    return feed.read();
+  }
+  int peek(){ return feed.peek(); }
+  size_t write(uint8_t){ return 0; }
+ private:
+  synthetic_feed_t feed;
+  unsigned long length;
+  unsigned long start;
+  unsigned long bytes = 0;
+};
+
+// estimated time to send the pixels to the display in ms
+unsigned long spi_ms(unsigned long pixels){
+  return (unsigned long)((uint64_t)pixels * 16 / (TFT_SPI_MHZ * 1000));
+}
+
+void test_redraw_cost(){
+  // parse without any progress display
+  synthetic_feed_t feed(SYNTHETIC_COUNTRIES, SYNTHETIC_DAYS, SYNTHETIC_PRETTY);
+  process_data(feed, store);
+  TEST_ASSERT_TRUE(store->valid);
+  unsigned long parse_us = parse_stats.total_us;
+  unsigned long file_bytes = parse_stats.bytes;
+  // v1.09: one full redraw per country
+  M5.Lcd.pixels = 0;
+  M5.Lcd.draw_calls = 0;
+  unsigned long start = micros();
+  for(int n=1; n<=SYNTHETIC_COUNTRIES; n++)
+    legacy_progress(n);
+  unsigned long legacy_us = micros() - start;
+  unsigned long legacy_pixels = M5.Lcd.pixels;
+  unsigned long legacy_calls = M5.Lcd.draw_calls;
+  // the progress task while the file is received
+  download_t download(file_bytes);
+  stream_length = file_bytes;
+  M5.Lcd.pixels = 0;
+  M5.Lcd.draw_calls = 0;
+  start = micros();
+  progress_begin("Progress test");
+  process_data(download, store);
+  progress_end();
+  unsigned long progress_us = micros() - start;
+  TEST_ASSERT_TRUE(store->valid);
+  unsigned long progress_pixels = M5.Lcd.pixels;
+  unsigned long progress_calls = M5.Lcd.draw_calls;
+  // the bar is full at the end
+  TEST_ASSERT_EQUAL_INT(PROGRESS_BAR_WIDTH, progress_drawn);
+
+  printf("file %lu bytes, %i countries, parse %lu ms (host)\n", file_bytes, SYNTHETIC_COUNTRIES, parse_us/1000);
+  printf("display                     pixels  calls  SPI ms (est.)  host ms\n");
+  printf("v1.09, %3i full redraws   %9lu %6lu %14lu %8lu  in the parse loop\n", SYNTHETIC_COUNTRIES,
+         legacy_pixels, legacy_calls, spi_ms(legacy_pixels), legacy_us/1000);
+  printf("progress task, %4lu ms    %9lu %6lu %14lu %8lu  on the other core\n", (unsigned long)DOWNLOAD_MS,
+         progress_pixels, progress_calls, spi_ms(progress_pixels), progress_us/1000);
+  printf("progress task per s of download: %lu pixels, %lu ms SPI (est.)\n",
+         progress_pixels*1000/DOWNLOAD_MS, spi_ms(progress_pixels*1000/DOWNLOAD_MS));
+  // one full screen per country against a bar that grows
+  TEST_ASSERT_GREATER_THAN((unsigned long)SYNTHETIC_COUNTRIES * M5.Lcd.width() * M5.Lcd.height() - 1, legacy_pixels);
+  TEST_ASSERT_LESS_OR_EQUAL(legacy_pixels/10, progress_pixels);
+}
+
+int main(int argc, char **argv){
+  UNITY_BEGIN();
+  RUN_TEST(test_redraw_cost);
+  return UNITY_END();
+}
@@ -0,0 +1,167 @@
+/**************************************************************************
+ * Render regression test of all views
+ *
+ * Every display_state is drawn from the recorded data file
+ * timeseries.json into the framebuffer of the mock display and
+ * compared with the golden images golden/view_<state>.ppm (the
+ * format of M5Screen2File()). The mock draws a pattern instead of
+ * the glyphs, so the images are the ones of the host, not of the
+ * device. golden/view_<state>.txt holds the lines of the graph
+ * renderer and the drawing calls of the golden run.
+ * [PIXELS]: more than RENDER_PIXEL_TOLERANCE pixels differ
+ * [LINES]:  more lines than at the golden run
+ * [CALLS]:  more drawing calls than at the golden run
+ * Missing golden files are written ([NEW]), so the first run of a
+ * known good version records them. Delete the files to record them
+ * again. The time to draw every view is printed (host times).
+**************************************************************************/
+#include <unity.h>
+#include "../../main.cpp"
+
+#define RENDER_PATH "/test/test_render"
+// a pixel differs if a colour channel differs by more than this
+#define RENDER_COLOR_TOLERANCE 8
+// differing pixels per view that are still accepted
+#define RENDER_PIXEL_TOLERANCE 16
+
+series_store_t test_store;
+
+void setUp(){
+  store = &test_store;
+  // the file never has to wait for data
+  parse_timeout_ms = 0;
+  stream_length = 0;
+}
+
+void tearDown(){}
+
+//==============================================================
+// Number of pixels on the screen that differ from a golden PPM
+// file by more than RENDER_COLOR_TOLERANCE in a colour channel
+// returns -1 if the file is missing or has another size
+long compare_screen(fs::FS &fs, const char *path){
+  File file = fs.open(path, FILE_READ);
+  if(!file)
+    return -1;
+  char header[32];
+  char file_header[32];
+  int header_length = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", TFT_HEIGHT, TFT_WIDTH);
+  if(file.read((uint8_t*)file_header, header_length) != (size_t)header_length ||
+     memcmp(header, file_header, header_length) != 0){
+    file.close();
+    return -1;
+  }
+  static uint8_t screen_line[TFT_HEIGHT*3];
+  static uint8_t golden_line[TFT_HEIGHT*3];
+  long differences = 0;
+  for(int y = 0; y < TFT_WIDTH; y++){
+    if(file.read(golden_line, sizeof(golden_line)) != sizeof(golden_line)){
+      file.close();
+      return -1;
+    }
+    M5.Lcd.readRectRGB(0, y, TFT_HEIGHT, 1, screen_line);
+    for(int x = 0; x < TFT_HEIGHT*3; x += 3){
+      if(abs(screen_line[x] - golden_line[x]) > RENDER_COLOR_TOLERANCE ||
+         abs(screen_line[x+1] - golden_line[x+1]) > RENDER_COLOR_TOLERANCE ||
+         abs(screen_line[x+2] - golden_line[x+2]) > RENDER_COLOR_TOLERANCE)
+        differences++;
+    }
+  }
+  file.close();
+  return differences;
+}
+
+//==============================================================
+// The recorded file is read like the download
+void test_load(){
+  File file = SD.open(RENDER_PATH "/timeseries.json", FILE_READ);
+  TEST_ASSERT_TRUE(file);
+  process_data(file, store);
+  file.close();
+  TEST_ASSERT_TRUE(store->valid);
+  TEST_ASSERT_EQUAL_STRING("2020-3-25", store->last_date);
+  TEST_ASSERT_EQUAL_INT(64, store->series[0].count);
+}
+
+//==============================================================
+// Draw every view and compare it with the golden files
+void test_views(){
+  File data = SD.open(RENDER_PATH "/timeseries.json", FILE_READ);
+  process_data(data, store);
+  data.close();
+  // the first configured countries without zoom
+  for(int n=0; n<6; n++)
+    country_selection[n] = n;
+  view_data_index = -1;
+  zoom_level = 0;
+  zoom_offset = 0;
+  menu_state = 4;
+  if(!SD.exists(RENDER_PATH "/golden"))
+    SD.mkdir(RENDER_PATH "/golden");
+  printf("view  time us  lines  golden   calls  golden    pixels  differ  result\n");
+  int failed = 0;
+  for(int state=1; state<=n_display_states; state++){
+    graph_draw_calls = 0;
+    M5.Lcd.draw_calls = 0;
+    M5.Lcd.pixels = 0;
+    unsigned long start = micros();
+    display_data(state);
+    unsigned long duration_us = micros() - start;
+    unsigned long lines = graph_draw_calls;
+    unsigned long calls = M5.Lcd.draw_calls;
+    char result[32] = "";
+    // compare the screen
+    char path[64];
+    snprintf(path, sizeof(path), "%s/golden/view_%i.ppm", RENDER_PATH, state);
+    long pixels = compare_screen(SD, path);
+    if(pixels < 0){
+      if(M5Screen2File(SD, path))
+        strcat(result, "[NEW]");
+      else
+        strcat(result, "[ERR]");
+    } else if(pixels > RENDER_PIXEL_TOLERANCE){
+      strcat(result, "[PIXELS]");
+    }
+    // compare the lines and the drawing calls
+    snprintf(path, sizeof(path), "%s/golden/view_%i.txt", RENDER_PATH, state);
+    unsigned long golden_lines = 0;
+    unsigned long golden_calls = 0;
+    bool golden = false;
+    File file = SD.open(path, FILE_READ);
+    if(file){
+      char text[32];
+      size_t length = file.read((uint8_t*)text, sizeof(text)-1);
+      text[length] = 0;
+      golden = (sscanf(text, "%lu %lu", &golden_lines, &golden_calls) == 2);
+      file.close();
+    }
+    if(!golden){
+      file = SD.open(path, FILE_WRITE);
+      if(file){
+        file.printf("%lu %lu\n", lines, calls);
+        file.close();
+        if(result[0] == 0)
+          strcat(result, "[NEW]");
+      }
+    } else {
+      if(lines > golden_lines)
+        strcat(result, "[LINES]");
+      if(calls > golden_calls)
+        strcat(result, "[CALLS]");
+    }
+    if(result[0] == 0)
+      strcat(result, "[OK]");
+    else if(strcmp(result, "[NEW]") != 0)
+      failed++;
+    printf("%4i %8lu %6lu %7lu %7lu %7lu %9lu %7li  %s\n", state, duration_us, lines, golden_lines,
+           calls, golden_calls, M5.Lcd.pixels, pixels, result);
+  }
+  TEST_ASSERT_EQUAL_INT(0, failed);
+}
+
+int main(int argc, char **argv){
+  UNITY_BEGIN();
+  RUN_TEST(test_load);
+  RUN_TEST(test_views);
+  return UNITY_END();
+}
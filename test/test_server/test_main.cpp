@@ -0,0 +1,309 @@
+/**************************************************************************
+ * Requests to the HTTP server over the loopback interface
+ *
+ * The server task of main.cpp serves a synthetic store, the test
+ * sends the requests with the socket clients of the WiFi mock:
+ * the responses of HTTP/1.1 (chunked) and HTTP/1.0 (until the end
+ * of the connection), the binary form against the store, the
+ * hand-over of replaced stores while a response is sent, and the
+ * latency and requests per second of all paths (host numbers,
+ * not the numbers of the ESP32).
+**************************************************************************/
+#define SERIES_SERVER
+#include <unity.h>
+#include "../../main.cpp"
+#include "../common/synthetic_feed.h"
+
+#define BENCHMARK_REQUESTS 50
+#define REFRESH_SWAPS 20
+
+void setUp(){
+  // the streams in memory never have to wait for data
+  parse_timeout_ms = 0;
+  stream_length = 0;
+}
+
+void tearDown(){}
+
+//==============================================================
+// A store on the heap like the one of a refresh
+series_store_t *synthetic_store(int days){
+  series_store_t *target = (series_store_t*)malloc(sizeof(series_store_t));
+  synthetic_feed_t feed(SYNTHETIC_COUNTRIES, days, SYNTHETIC_MINIFIED);
+  process_data(feed, target);
+  return target;
+}
+
+// free heap when the server task has closed the last connection
+size_t idle_free_heap(){
+  delay(10*SERVER_POLL_MS);
+  return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+//==============================================================
+// Send a request and read the response until the server
+// closes the connection
+std::string fetch(const char *request){
+  WiFiClient http_client;
+  for(int n=0; n<100 && !http_client.connect("127.0.0.1", SERVER_PORT); n++)
+    delay(10);
+  http_client.print(request);
+  std::string response;
+  unsigned long last_byte = millis();
+  while(millis() - last_byte < SERVER_TIMEOUT_MS){
+    uint8_t buffer[4096];
+    int length = http_client.read(buffer, sizeof(buffer));
+    if(length > 0){
+      response.append((const char*)buffer, length);
+      last_byte = millis();
+    } else if(!http_client.connected())
+      break;
+    else
+      delay(1);
+  }
+  http_client.stop();
+  return response;
+}
+
+std::string get(const char *path, const char *version = "HTTP/1.1"){
+  char request[128];
+  snprintf(request, sizeof(request), "GET %s %s\r\nHost: localhost\r\n\r\n", path, version);
+  return fetch(request);
+}
+
+std::string headers(const std::string &response){
+  return response.substr(0, response.find("\r\n\r\n")+2);
+}
+
+// body of the response, the chunks joined
+// returns "<error>" if the chunks are broken
+std::string body(const std::string &response){
+  size_t pos = response.find("\r\n\r\n");
+  if(pos == std::string::npos)
+    return "<error>";
+  pos += 4;
+  if(headers(response).find("Transfer-Encoding: chunked\r\n") == std::string::npos)
+    return response.substr(pos);
+  std::string data;
+  while(true){
+    size_t line_end = response.find("\r\n", pos);
+    if(line_end == std::string::npos)
+      return "<error>";
+    unsigned long size = strtoul(response.c_str()+pos, NULL, 16);
+    if(size == 0)
+      return response.compare(line_end, 4, "\r\n\r\n") == 0 ? data : "<error>";
+    if(line_end+2+size+2 > response.size() || response.compare(line_end+2+size, 2, "\r\n") != 0)
+      return "<error>";
+    data.append(response, line_end+2, size);
+    pos = line_end+2+size+2;
+  }
+}
+
+//==============================================================
+// Decode the binary form and compare it with the store
+// (source NULL: only check that the series are consistent)
+// returns the number of errors
+int check_binary(const std::string &data, const series_store_t *source){
+  const uint8_t *p = (const uint8_t*)data.data();
+  const uint8_t *end = p + data.size();
+  if(data.size() < 23 || memcmp(p, "C19S\x01", 5) != 0)
+    return 1;
+  int errors = 0;
+  int n_ids = p[21] | p[22] << 8;
+  p += 23;
+  for(int n=0; n<n_ids; n++){
+    if(end - p < 19)
+      return errors + 1;
+    uint32_t fields[7];
+    const int field_size[7] = {2, 2, 2, 4, 4, 2, 2};
+    for(int f=0; f<7; f++){
+      fields[f] = 0;
+      for(int b=0; b<field_size[f]; b++)
+        fields[f] |= (uint32_t)*p++ << (8*b);
+    }
+    int name_length = *p++;
+    if(end - p < name_length + (long)fields[5] + (long)fields[6])
+      return errors + 1;
+    std::string name((const char*)p, name_length);
+    p += name_length;
+    int id = fields[0];
+    int count = fields[1];
+    if(source != NULL){
+      errors += (id >= n_series);
+      if(id >= n_series)
+        continue;
+      const series_t *series = &source->series[id];
+      errors += (count != series->count) + (fields[2] != series->first_day);
+      errors += (name != series_name_in(source, id));
+    }
+    for(int m=0; m<2; m++){
+      const uint8_t *days_end = p + fields[5+m];
+      int values[SERIES_LENGTH];
+      if(source != NULL)
+        load_series(source, id, m, values);
+      uint32_t value = 0;
+      for(int i=0; i<count && p < days_end; i++){
+        uint32_t code = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+          byte = *p++;
+          code |= (uint32_t)(byte & 0x7F) << shift;
+          shift += 7;
+        } while((byte & 0x80) && p < days_end);
+        value += (uint32_t)((int32_t)(code >> 1) ^ -(int32_t)(code & 1));
+        if(source != NULL)
+          errors += ((int)value != values[i]);
+      }
+      errors += (p != days_end);
+      errors += (count > 0 && (int)value != (int)fields[3+m]);
+      p = days_end;
+    }
+  }
+  return errors + (p != end);
+}
+
+//==============================================================
+// All paths with HTTP/1.1: chunked responses
+void test_responses(){
+  std::string response = get("/summary.json");
+  TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200 OK\r\n", headers(response).substr(0, 17).c_str());
+  TEST_ASSERT_TRUE(headers(response).find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+  std::string summary = body(response);
+  TEST_ASSERT_EQUAL_STRING("{\"last_date\":", summary.substr(0, 13).c_str());
+  TEST_ASSERT_EQUAL_STRING("]}]}", summary.substr(summary.size()-4).c_str());
+
+  std::string series = body(get("/series.json?id=10"));
+  char name[64];
+  snprintf(name, sizeof(name), "\"id\":10,\"name\":\"%s\"", series_name(10));
+  TEST_ASSERT_TRUE(series.find(name) != std::string::npos);
+  TEST_ASSERT_EQUAL_STRING("]}]}", series.substr(series.size()-4).c_str());
+
+  std::string binary = body(get("/series.bin"));
+  TEST_ASSERT_GREATER_THAN(1000, binary.size());
+  TEST_ASSERT_EQUAL_INT(0, check_binary(binary, store));
+  TEST_ASSERT_EQUAL_INT(0, check_binary(body(get("/series.bin?id=selected")), store));
+
+  TEST_ASSERT_EQUAL_STRING("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n",
+                           headers(get("/nothing")).substr(0, 43).c_str());
+  TEST_ASSERT_EQUAL_STRING("HTTP/1.1 405 Method Not Allowed\r\n",
+                           headers(fetch("POST /summary.json HTTP/1.1\r\n\r\n")).substr(0, 33).c_str());
+}
+
+//==============================================================
+// HTTP/1.0 knows no chunks: the body ends with the connection
+void test_http_10(){
+  const char *paths[3] = {"/summary.json", "/series.json", "/series.bin"};
+  for(int p=0; p<3; p++){
+    std::string response = get(paths[p], "HTTP/1.0");
+    TEST_ASSERT_EQUAL_STRING("HTTP/1.0 200 OK\r\n", headers(response).substr(0, 17).c_str());
+    TEST_ASSERT_TRUE(headers(response).find("Transfer-Encoding") == std::string::npos);
+    TEST_ASSERT_TRUE(body(response) == body(get(paths[p])));
+  }
+  TEST_ASSERT_EQUAL_INT(0, check_binary(body(get("/series.bin", "HTTP/1.0")), store));
+  TEST_ASSERT_EQUAL_STRING("HTTP/1.0 404 Not Found\r\n",
+                           headers(get("/nothing", "HTTP/1.0")).substr(0, 24).c_str());
+}
+
+//==============================================================
+// A store that is still sent is retired by the swap, a retired
+// store that is not sent any more is freed by the next swap.
+// served_store is set by the test like a response would do it.
+void test_retired_store(){
+  size_t free_before = idle_free_heap();
+  series_store_t *first = store;
+  refreshed_store = synthetic_store(SYNTHETIC_DAYS-1);
+  series_store_t *second = refreshed_store;
+  xSemaphoreTake(store_mutex, portMAX_DELAY);
+  served_store = first;
+  xSemaphoreGive(store_mutex);
+  swap_store();
+  TEST_ASSERT_TRUE(store == second);
+  TEST_ASSERT_TRUE(retired_store == first);
+  // the second store is sent when the next refresh is done
+  xSemaphoreTake(store_mutex, portMAX_DELAY);
+  served_store = second;
+  xSemaphoreGive(store_mutex);
+  refreshed_store = synthetic_store(SYNTHETIC_DAYS);
+  series_store_t *third = refreshed_store;
+  swap_store();
+  TEST_ASSERT_TRUE(store == third);
+  TEST_ASSERT_TRUE(retired_store == second);
+  // the end of the response frees the second store
+  xSemaphoreTake(store_mutex, portMAX_DELAY);
+  served_store = NULL;
+  series_store_t *old_store = retired_store;
+  retired_store = NULL;
+  xSemaphoreGive(store_mutex);
+  free(old_store);
+  // only the live store is left
+  TEST_ASSERT_EQUAL_INT(free_before, idle_free_heap());
+  TEST_ASSERT_EQUAL_INT(0, check_binary(body(get("/series.bin")), store));
+}
+
+//==============================================================
+// Refreshes while a client requests the binary form without pause
+// Every response has to be consistent and no store may be lost.
+void test_refresh_during_requests(){
+  size_t free_before = idle_free_heap();
+  volatile bool running = true;
+  int responses = 0, errors = 0;
+  std::thread client([&](){
+    while(running){
+      errors += check_binary(body(get("/series.bin")), NULL);
+      responses++;
+    }
+  });
+  for(int n=0; n<REFRESH_SWAPS; n++){
+    refreshed_store = synthetic_store(SYNTHETIC_DAYS - n % 2);
+    swap_store();
+    delay(5);
+  }
+  running = false;
+  client.join();
+  printf("%i responses during %i refreshes\n", responses, REFRESH_SWAPS);
+  TEST_ASSERT_EQUAL_INT(0, errors);
+  TEST_ASSERT_GREATER_THAN(0, responses);
+  // the last response has freed its store
+  TEST_ASSERT_TRUE(served_store == NULL);
+  TEST_ASSERT_TRUE(retired_store == NULL);
+  // the thread of the client leaves a few bytes, a store is larger
+  TEST_ASSERT_LESS_OR_EQUAL((long)sizeof(series_store_t)/2, (long)free_before - (long)idle_free_heap());
+}
+
+//==============================================================
+// Latency (connect until the last byte) and requests per second
+void test_benchmark(){
+  const char *paths[4] = {"/summary.json", "/series.json", "/series.bin", "/series.bin?id=selected"};
+  printf("path                      bytes   min us   avg us   max us  requests/s\n");
+  for(int p=0; p<4; p++){
+    unsigned long min_us = (unsigned long)-1, max_us = 0, total_us = 0, bytes = 0;
+    for(int r=0; r<BENCHMARK_REQUESTS; r++){
+      unsigned long start = micros();
+      std::string response = get(paths[p]);
+      unsigned long duration = micros() - start;
+      TEST_ASSERT_EQUAL_STRING("HTTP/1.1 200 OK\r\n", response.substr(0, 17).c_str());
+      bytes = body(response).size();
+      min_us = std::min(min_us, duration);
+      max_us = std::max(max_us, duration);
+      total_us += duration;
+    }
+    printf("%-24s %7lu %8lu %8lu %8lu %11lu\n", paths[p], bytes, min_us, total_us/BENCHMARK_REQUESTS,
+           max_us, (unsigned long)(1000000ULL*BENCHMARK_REQUESTS/std::max(total_us, 1UL)));
+  }
+  printf("served %lu requests, %lu bytes, max %lu us\n",
+         server_stats.requests, server_stats.bytes, server_stats.max_us);
+}
+
+int main(int argc, char **argv){
+  store = synthetic_store(SYNTHETIC_DAYS);
+  store_mutex = xSemaphoreCreateMutex();
+  xTaskCreatePinnedToCore(server_task, "server", SERVER_TASK_STACK, NULL, 1, NULL, 0);
+  UNITY_BEGIN();
+  RUN_TEST(test_responses);
+  RUN_TEST(test_http_10);
+  RUN_TEST(test_retired_store);
+  RUN_TEST(test_refresh_during_requests);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}